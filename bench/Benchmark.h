@@ -0,0 +1,73 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+
+namespace bench
+{
+    /**
+     * A single run of a benchmark. Only the code passed to measure() is timed,
+     * so setup code can live in the benchmark function itself.
+     */
+    class Run
+    {
+    public:
+        explicit Run(uint64_t iterations)
+            : m_iterations(iterations)
+            , m_elapsed(0) {}
+
+        template <typename F>
+        void measure(F&& body)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < m_iterations; ++i) { body(i); }
+            m_elapsed += std::chrono::steady_clock::now() - start;
+        }
+
+        uint64_t iterations() const { return m_iterations; }
+        std::chrono::nanoseconds elapsed() const { return m_elapsed; }
+
+    private:
+        uint64_t m_iterations;
+        std::chrono::nanoseconds m_elapsed;
+    };
+
+    using BenchmarkFunction = void (*)(Run&);
+
+    struct Benchmark
+    {
+        const char* name;
+        uint64_t iterations;
+        BenchmarkFunction function;
+    };
+
+    /**
+     * All benchmarks known to the benchmark executable.
+     */
+    inline std::vector<Benchmark>& benchmarks()
+    {
+        static std::vector<Benchmark> all;
+        return all;
+    }
+
+    /**
+     * Registers a benchmark during static initialization.
+     */
+    struct Registrar
+    {
+        Registrar(const char* name, uint64_t iterations, BenchmarkFunction f)
+        {
+            benchmarks().push_back({ name, iterations, f });
+        }
+    };
+
+    /**
+     * Prevents the compiler from optimizing away a computed value.
+     */
+    template <typename T>
+    inline void keep(const T& value)
+    {
+        asm volatile("" : : "g"(&value) : "memory");
+    }
+}
@@ -0,0 +1,37 @@
+#include <LuaSlabAllocator.h>
+#include <LuaState.h>
+#include <Benchmark.h>
+
+
+using lpp::LuaState;
+
+static const char* const SCRIPT = "bench/allocator_bench.lua";
+static const uint64_t ITERATIONS = 1000;
+static const int32_t OBJECTS_PER_ITERATION = 1000;
+
+
+template <bool use_slab_allocator>
+static void run_workload(bench::Run& run, std::string&& workload)
+{
+    LuaState lua = use_slab_allocator
+                 ? LuaState(std::make_shared<lpp::LuaSlabAllocator>())
+                 : LuaState();
+    auto f = lua.import_function_from(SCRIPT)
+                .with_name(std::move(workload))
+                .with_return_type<int32_t>()
+                .with_params<int32_t>()
+                .build();
+
+    run.measure([&](uint64_t) {
+        bench::keep(f(OBJECTS_PER_ITERATION));
+    });
+}
+
+static bench::Registrar r1("Allocator: tables, default", ITERATIONS,
+                           [](bench::Run& run) { run_workload<false>(run, "tables"); });
+static bench::Registrar r2("Allocator: tables, slab", ITERATIONS,
+                           [](bench::Run& run) { run_workload<true>(run, "tables"); });
+static bench::Registrar r3("Allocator: strings, default", ITERATIONS,
+                           [](bench::Run& run) { run_workload<false>(run, "strings"); });
+static bench::Registrar r4("Allocator: strings, slab", ITERATIONS,
+                           [](bench::Run& run) { run_workload<true>(run, "strings"); });
@@ -0,0 +1,17 @@
+function tables(n)
+    local count = 0
+    for i = 1, n do
+        local t = { i, i + 1, key = i }
+        count = count + #t
+    end
+    return count
+end
+
+function strings(n)
+    local length = 0
+    for i = 1, n do
+        local s = "key_" .. i .. "_" .. (i * 7)
+        length = length + #s
+    end
+    return length
+end
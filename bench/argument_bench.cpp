@@ -0,0 +1,67 @@
+#include <LuaState.h>
+#include <Benchmark.h>
+
+
+using lpp::LuaState;
+
+static const char* const SCRIPT = "bench/argument_bench.lua";
+static const uint64_t ITERATIONS = 100;
+static const int32_t CALLS_PER_ITERATION = 10000;
+
+int64_t args_1(int64_t a);
+int64_t args_4(int64_t a, double b, std::string c, bool d);
+int64_t args_12(int64_t a, int64_t b, int64_t c, int64_t d,
+                double e, double f, double g, double h,
+                std::string i, std::string j, bool k, bool l);
+
+
+int64_t args_1(int64_t a)
+{
+    return a;
+}
+
+int64_t args_4(int64_t a, double b, std::string c, bool d)
+{
+    return a + static_cast<int64_t>(b) + static_cast<int64_t>(c.size()) + d;
+}
+
+int64_t args_12(int64_t a, int64_t b, int64_t c, int64_t d,
+                double e, double f, double g, double h,
+                std::string i, std::string j, bool k, bool l)
+{
+    return a + b + c + d + static_cast<int64_t>(e + f + g + h)
+         + static_cast<int64_t>(i.size() + j.size()) + k + l;
+}
+
+template <lpp::LuaArgPolicy Policy = lpp::LuaArgPolicy::lenient>
+static void run_calls(bench::Run& run, std::string&& func_name)
+{
+    LuaState lua;
+    lua.export_function<Policy>(args_1, "args_1");
+    lua.export_function<Policy>(args_4, "args_4");
+    lua.export_function<Policy>(args_12, "args_12");
+    auto f = lua.import_function_from(SCRIPT)
+                .with_name(std::move(func_name))
+                .with_return_type<int64_t>()
+                .with_params<int32_t>()
+                .build();
+
+    run.measure([&](uint64_t) {
+        bench::keep(f(CALLS_PER_ITERATION));
+    });
+}
+
+static bench::Registrar r1("10k calls of exported function, 1 argument", ITERATIONS,
+                           [](bench::Run& run) { run_calls(run, "call_1"); });
+static bench::Registrar r2("10k calls of exported function, 4 arguments", ITERATIONS,
+                           [](bench::Run& run) { run_calls(run, "call_4"); });
+static bench::Registrar r3("10k calls of exported function, 12 arguments", ITERATIONS,
+                           [](bench::Run& run) { run_calls(run, "call_12"); });
+static bench::Registrar r4("10k calls of exported function, 4 arguments, strict", ITERATIONS,
+                           [](bench::Run& run) {
+                               run_calls<lpp::LuaArgPolicy::strict>(run, "call_4");
+                           });
+static bench::Registrar r5("10k calls of exported function, 4 arguments, unchecked", ITERATIONS,
+                           [](bench::Run& run) {
+                               run_calls<lpp::LuaArgPolicy::unchecked>(run, "call_4");
+                           });
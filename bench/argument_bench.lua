@@ -0,0 +1,19 @@
+function call_1(n)
+    local total = 0
+    for i = 1, n do total = total + args_1(i) end
+    return total
+end
+
+function call_4(n)
+    local total = 0
+    for i = 1, n do total = total + args_4(i, 2.5, "name", true) end
+    return total
+end
+
+function call_12(n)
+    local total = 0
+    for i = 1, n do
+        total = total + args_12(i, 2, 3, 4, 1.5, 2.5, 3.5, 4.5, "a", "b", true, false)
+    end
+    return total
+end
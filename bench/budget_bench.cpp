@@ -0,0 +1,93 @@
+#include <chrono>
+#include <cstdint>
+#include <LuaState.h>
+#include <Benchmark.h>
+
+
+using lpp::LuaState;
+using lpp::LuaBudget;
+
+static const char* const SCRIPT = "bench/budget_bench.lua";
+static const uint64_t ITERATIONS = 100;
+static const int64_t LOOP_SIZE = 1000000;
+static const uint64_t CALL_ITERATIONS = 1000000;
+
+
+/**
+ * A long running call (a loop of 1M iterations, ~4M VM instructions), to
+ * measure the cost of the hook itself at a certain check granularity.
+ */
+static void run_loop(bench::Run& run, const LuaBudget& budget)
+{
+    LuaState lua;
+    lua.set_budget(budget);
+    auto sum = lua.import_function_from(SCRIPT)
+                  .with_name("sum")
+                  .with_return_type<int64_t>()
+                  .with_params<int64_t>()
+                  .build();
+
+    run.measure([&](uint64_t) {
+        bench::keep(sum(LOOP_SIZE));
+    });
+}
+
+static LuaBudget instruction_budget(uint32_t check_every)
+{
+    LuaBudget budget;
+    budget.max_instructions = UINT64_MAX;
+    budget.check_every = check_every;
+    return budget;
+}
+
+static LuaBudget deadline_budget(uint32_t check_every)
+{
+    LuaBudget budget;
+    budget.timeout = std::chrono::hours(1);
+    budget.check_every = check_every;
+    return budget;
+}
+
+/**
+ * Many short calls, to measure the cost of installing and removing the hook
+ * for every call.
+ */
+static void run_calls(bench::Run& run, const LuaBudget& budget)
+{
+    LuaState lua;
+    lua.set_budget(budget);
+    auto add = lua.import_function_from(SCRIPT)
+                  .with_name("add")
+                  .with_return_type<int32_t>()
+                  .with_params<int32_t, int32_t>()
+                  .build();
+
+    run.measure([&](uint64_t i) {
+        bench::keep(add(static_cast<int32_t>(i), 1));
+    });
+}
+
+static bench::Registrar r1("1M iteration loop, no budget", ITERATIONS,
+                           [](bench::Run& run) { run_loop(run, LuaBudget()); });
+static bench::Registrar r2("1M iteration loop, instruction budget, check every 1", ITERATIONS,
+                           [](bench::Run& run) { run_loop(run, instruction_budget(1)); });
+static bench::Registrar r3("1M iteration loop, instruction budget, check every 100", ITERATIONS,
+                           [](bench::Run& run) { run_loop(run, instruction_budget(100)); });
+static bench::Registrar r4("1M iteration loop, instruction budget, check every 1000", ITERATIONS,
+                           [](bench::Run& run) { run_loop(run, instruction_budget(1000)); });
+static bench::Registrar r5("1M iteration loop, instruction budget, check every 10000", ITERATIONS,
+                           [](bench::Run& run) { run_loop(run, instruction_budget(10000)); });
+static bench::Registrar r6("1M iteration loop, deadline, check every 100", ITERATIONS,
+                           [](bench::Run& run) { run_loop(run, deadline_budget(100)); });
+static bench::Registrar r7("1M iteration loop, deadline, check every 1000", ITERATIONS,
+                           [](bench::Run& run) { run_loop(run, deadline_budget(1000)); });
+static bench::Registrar r8("1M iteration loop, deadline, check every 10000", ITERATIONS,
+                           [](bench::Run& run) { run_loop(run, deadline_budget(10000)); });
+static bench::Registrar r9("LuaFunction call, no budget", CALL_ITERATIONS,
+                           [](bench::Run& run) { run_calls(run, LuaBudget()); });
+static bench::Registrar r10("LuaFunction call, instruction budget and deadline", CALL_ITERATIONS,
+                            [](bench::Run& run) {
+                                LuaBudget budget = deadline_budget(1000);
+                                budget.max_instructions = UINT64_MAX;
+                                run_calls(run, budget);
+                            });
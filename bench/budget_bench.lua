@@ -0,0 +1,10 @@
+
+function sum(n)
+    local total = 0
+    for i = 1, n do total = total + i end
+    return total
+end
+
+function add(x, y)
+    return x + y
+end
@@ -0,0 +1,63 @@
+#include <LuaState.h>
+#include <Benchmark.h>
+
+
+using lpp::LuaState;
+
+static const char* const SCRIPT = "bench/lua_function_bench.lua";
+static const uint64_t ITERATIONS = 1000;
+static const size_t BATCH_SIZE = 1000;
+
+
+static auto import_add(LuaState& lua)
+{
+    return lua.import_function_from(SCRIPT)
+              .with_name("add")
+              .with_return_type<int32_t>()
+              .with_params<int32_t, int32_t>()
+              .build();
+}
+
+static std::vector<std::tuple<int32_t, int32_t>> make_records()
+{
+    std::vector<std::tuple<int32_t, int32_t>> records;
+    for (size_t i = 0; i < BATCH_SIZE; ++i)
+    {
+        records.emplace_back(static_cast<int32_t>(i), 1);
+    }
+    return records;
+}
+
+static void call_per_record(bench::Run& run)
+{
+    LuaState lua;
+    auto add = import_add(lua);
+    auto records = make_records();
+    std::vector<int32_t> results(records.size());
+
+    run.measure([&](uint64_t) {
+        for (size_t i = 0; i < records.size(); ++i)
+        {
+            results[i] = add(std::get<0>(records[i]), std::get<1>(records[i]));
+        }
+        bench::keep(results);
+    });
+}
+
+static void call_batch(bench::Run& run)
+{
+    LuaState lua;
+    auto add = import_add(lua);
+    auto records = make_records();
+    std::vector<int32_t> results(records.size());
+
+    run.measure([&](uint64_t) {
+        add.call_batch(records.begin(), records.end(), results.begin());
+        bench::keep(results);
+    });
+}
+
+static bench::Registrar r1("LuaFunction 1000 records, call per record", ITERATIONS,
+                           call_per_record);
+static bench::Registrar r2("LuaFunction 1000 records, call_batch", ITERATIONS,
+                           call_batch);
@@ -0,0 +1,46 @@
+// Translation unit for measuring compile times of exported functions, see
+// scripts/measure_compile_time.sh. Exports LPP_EXPORTS functions with
+// LPP_ARITY parameters each, all with a different signature.
+#include <string>
+#include <tuple>
+#include <utility>
+#include <LuaState.h>
+
+#ifndef LPP_ARITY
+#define LPP_ARITY 12
+#endif
+
+#ifndef LPP_EXPORTS
+#define LPP_EXPORTS 32
+#endif
+
+
+using lpp::LuaState;
+
+template <size_t N, size_t I>
+using Arg = std::tuple_element_t<(N + I) % 4, std::tuple<int64_t, double, std::string, bool>>;
+
+template <size_t N, size_t... Is>
+int64_t wide(Arg<N, Is>...)
+{
+    return static_cast<int64_t>(N);
+}
+
+template <size_t N, size_t... Is>
+void export_wide(LuaState& lua, std::index_sequence<Is...>)
+{
+    lua.export_function<&wide<N, Is...>>("wide_" + std::to_string(N));
+}
+
+template <size_t... Ns>
+void export_all(LuaState& lua, std::index_sequence<Ns...>)
+{
+    (export_wide<Ns>(lua, std::make_index_sequence<LPP_ARITY>{}), ...);
+}
+
+void export_wide_functions(LuaState& lua);
+
+void export_wide_functions(LuaState& lua)
+{
+    export_all(lua, std::make_index_sequence<LPP_EXPORTS>{});
+}
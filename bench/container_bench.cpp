@@ -0,0 +1,65 @@
+#include <numeric>
+#include <vector>
+#include <lua.hpp>
+#include <LuaStackHelpers.hpp>
+#include <Benchmark.h>
+
+
+static const uint64_t ITERATIONS = 1000;
+static const size_t ELEMENTS = 10000;
+
+static std::vector<int64_t> make_values()
+{
+    std::vector<int64_t> values(ELEMENTS);
+    std::iota(values.begin(), values.end(), 0);
+    return values;
+}
+
+// What pushing a vector looked like before: an empty table, grown by
+// lua_settable one element at a time.
+static void push_naive(lua_State* plua, const std::vector<int64_t>& values)
+{
+    lua_newtable(plua);
+    lua_Integer i = 1;
+    for (auto value : values)
+    {
+        lua_pushinteger(plua, i++);
+        lua_pushinteger(plua, value);
+        lua_settable(plua, -3);
+    }
+}
+
+static void run_push(bench::Run& run, bool presized)
+{
+    lua_State* plua = luaL_newstate();
+    auto values = make_values();
+
+    run.measure([&](uint64_t) {
+        if (presized) { lpp::push_on_stack(plua, values); }
+        else { push_naive(plua, values); }
+        bench::keep(lua_rawlen(plua, -1));
+        lua_pop(plua, 1);
+    });
+
+    lua_close(plua);
+}
+
+static void run_get(bench::Run& run)
+{
+    lua_State* plua = luaL_newstate();
+    lpp::push_on_stack(plua, make_values());
+
+    run.measure([&](uint64_t) {
+        std::vector<int64_t> values = lpp::LuaStackGetter(plua, -1);
+        bench::keep(values.size());
+    });
+
+    lua_close(plua);
+}
+
+static bench::Registrar r1("push 10k element vector, lua_settable", ITERATIONS,
+                           [](bench::Run& run) { run_push(run, false); });
+static bench::Registrar r2("push 10k element vector, presized + rawseti", ITERATIONS,
+                           [](bench::Run& run) { run_push(run, true); });
+static bench::Registrar r3("get 10k element vector", ITERATIONS,
+                           [](bench::Run& run) { run_get(run); });
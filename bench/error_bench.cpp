@@ -0,0 +1,82 @@
+#include <stdexcept>
+#include <LuaState.h>
+#include <Benchmark.h>
+
+
+using lpp::LuaState;
+
+static const char* const SCRIPT = "bench/error_bench.lua";
+static const uint64_t ITERATIONS = 100;
+static const int32_t CALLS_PER_ITERATION = 10000;
+
+int32_t cpp_fail(int32_t x);
+int32_t cpp_ok(int32_t x);
+
+
+int32_t cpp_fail(int32_t)
+{
+    throw std::runtime_error("failed");
+}
+
+int32_t cpp_ok(int32_t x)
+{
+    return x;
+}
+
+static void run_pcalls(bench::Run& run, std::string&& func_name)
+{
+    LuaState lua;
+    lua.export_function(cpp_fail, "cpp_fail");
+    lua.export_function(cpp_ok, "cpp_ok");
+    auto f = lua.import_function_from(SCRIPT)
+                .with_name(std::move(func_name))
+                .with_return_type<int32_t>()
+                .with_params<int32_t>()
+                .build();
+
+    run.measure([&](uint64_t) {
+        bench::keep(f(CALLS_PER_ITERATION));
+    });
+}
+
+static bench::Registrar r1("10k pcalls, C++ function succeeds", ITERATIONS,
+                           [](bench::Run& run) { run_pcalls(run, "run_cpp_ok"); });
+static bench::Registrar r2("10k pcalls, C++ function throws", ITERATIONS,
+                           [](bench::Run& run) { run_pcalls(run, "run_cpp_fail"); });
+static bench::Registrar r3("10k pcalls, Lua function raises error", ITERATIONS,
+                           [](bench::Run& run) { run_pcalls(run, "run_lua_fail"); });
+
+static void run_failing_calls(bench::Run& run, lpp::LuaTraceback mode)
+{
+    LuaState lua;
+    lua.set_traceback_mode(mode, 100);
+    auto f = lua.import_function_from(SCRIPT)
+                .with_name("lua_fail")
+                .with_return_type<void>()
+                .with_params<int32_t>()
+                .build();
+
+    run.measure([&](uint64_t i) {
+        try
+        {
+            f(static_cast<int32_t>(i));
+        }
+        catch (const lpp::LuaError& e)
+        {
+            bench::keep(e.traceback().size());
+        }
+    });
+}
+
+static bench::Registrar r4("failing LuaFunction call, no traceback", ITERATIONS * 1000,
+                           [](bench::Run& run) {
+                               run_failing_calls(run, lpp::LuaTraceback::none);
+                           });
+static bench::Registrar r5("failing LuaFunction call, traceback always", ITERATIONS * 1000,
+                           [](bench::Run& run) {
+                               run_failing_calls(run, lpp::LuaTraceback::always);
+                           });
+static bench::Registrar r6("failing LuaFunction call, traceback 1 in 100", ITERATIONS * 1000,
+                           [](bench::Run& run) {
+                               run_failing_calls(run, lpp::LuaTraceback::sampled);
+                           });
@@ -0,0 +1,16 @@
+function pcall_n(f, n)
+    local failures = 0
+    for i = 1, n do
+        local ok = pcall(f, i)
+        if not ok then failures = failures + 1 end
+    end
+    return failures
+end
+
+function lua_fail(x)
+    error("failed", 0)
+end
+
+function run_cpp_fail(n) return pcall_n(cpp_fail, n) end
+function run_cpp_ok(n) return pcall_n(cpp_ok, n) end
+function run_lua_fail(n) return pcall_n(lua_fail, n) end
@@ -0,0 +1,38 @@
+#include <LuaState.h>
+#include <Benchmark.h>
+
+
+using lpp::LuaState;
+
+static const char* const SCRIPT = "bench/export_bench.lua";
+static const uint64_t ITERATIONS = 100;
+static const int32_t CALLS_PER_ITERATION = 100000;
+
+int64_t clamp(int64_t x, int64_t low, int64_t high);
+
+
+int64_t clamp(int64_t x, int64_t low, int64_t high)
+{
+    return x < low ? low : (x > high ? high : x);
+}
+
+static void run_calls(bench::Run& run, bool compile_time)
+{
+    LuaState lua;
+    if (compile_time) { lua.export_function<&clamp>("clamp"); }
+    else { lua.export_function(clamp, "clamp"); }
+    auto call_n = lua.import_function_from(SCRIPT)
+                     .with_name("call_n")
+                     .with_return_type<int64_t>()
+                     .with_params<int32_t>()
+                     .build();
+
+    run.measure([&](uint64_t) {
+        bench::keep(call_n(CALLS_PER_ITERATION));
+    });
+}
+
+static bench::Registrar r1("100k calls of exported function, pointer in upvalue", ITERATIONS,
+                           [](bench::Run& run) { run_calls(run, false); });
+static bench::Registrar r2("100k calls of exported function, template parameter", ITERATIONS,
+                           [](bench::Run& run) { run_calls(run, true); });
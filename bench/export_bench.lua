@@ -0,0 +1,5 @@
+function call_n(n)
+    local total = 0
+    for i = 1, n do total = clamp(total + i, 0, 1000000) end
+    return total
+end
@@ -0,0 +1,53 @@
+#include <LuaState.h>
+#include <Benchmark.h>
+
+
+using lpp::LuaState;
+
+static const char* const SCRIPT = "bench/lua_class_bench.lua";
+static const uint64_t ITERATIONS = 100;
+static const int32_t CALLS_PER_ITERATION = 10000;
+
+struct Vec2
+{
+    double x;
+    double y;
+
+    Vec2(double x_, double y_) : x(x_), y(y_) {}
+
+    void add(double dx, double dy)
+    {
+        x += dx;
+        y += dy;
+    }
+
+    double length_squared() const { return x * x + y * y; }
+};
+
+static void run_methods(bench::Run& run, bool with_properties)
+{
+    LuaState lua;
+    auto cls = lua.register_class<Vec2>("Vec2");
+    cls.constructor<double, double>()
+       .method("add", &Vec2::add)
+       .method("length_squared", &Vec2::length_squared);
+    if (with_properties)
+    {
+        cls.property("x", &Vec2::x)
+           .property("y", &Vec2::y);
+    }
+    auto call_methods = lua.import_function_from(SCRIPT)
+                           .with_name("call_methods")
+                           .with_return_type<double>()
+                           .with_params<int32_t>()
+                           .build();
+
+    run.measure([&](uint64_t) {
+        bench::keep(call_methods(CALLS_PER_ITERATION));
+    });
+}
+
+static bench::Registrar r1("10k method calls, methods table as __index", ITERATIONS,
+                           [](bench::Run& run) { run_methods(run, false); });
+static bench::Registrar r2("10k method calls, __index with properties", ITERATIONS,
+                           [](bench::Run& run) { run_methods(run, true); });
@@ -0,0 +1,7 @@
+function call_methods(n)
+    local v = Vec2.new(0, 0)
+    for i = 1, n do
+        v:add(1, 2)
+    end
+    return v:length_squared()
+end
@@ -0,0 +1,45 @@
+#include <LuaState.h>
+#include <Benchmark.h>
+
+
+using lpp::LuaState;
+
+static const char* const SCRIPT = "bench/lua_function_bench.lua";
+static const uint64_t ITERATIONS = 1000000;
+
+
+static void call_via_get_global(bench::Run& run)
+{
+    LuaState lua;
+    lua.run_file(SCRIPT);
+    auto& stack = *lua.get_stack();
+    const std::string name = "add";
+
+    run.measure([&](uint64_t i) {
+        stack.get_global(name);
+        stack.push(static_cast<int32_t>(i));
+        stack.push(1);
+        stack.pcall(2, 1, 0);
+        bench::keep(stack.get<int32_t>(-1));
+        stack.pop(1);
+    });
+}
+
+static void call_via_registry_ref(bench::Run& run)
+{
+    LuaState lua;
+    auto add = lua.import_function_from(SCRIPT)
+                  .with_name("add")
+                  .with_return_type<int32_t>()
+                  .with_params<int32_t, int32_t>()
+                  .build();
+
+    run.measure([&](uint64_t i) {
+        bench::keep(add(static_cast<int32_t>(i), 1));
+    });
+}
+
+static bench::Registrar r1("LuaFunction call via get_global", ITERATIONS,
+                           call_via_get_global);
+static bench::Registrar r2("LuaFunction call via registry ref", ITERATIONS,
+                           call_via_registry_ref);
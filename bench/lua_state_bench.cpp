@@ -0,0 +1,35 @@
+#include <LuaState.h>
+#include <Benchmark.h>
+
+
+using lpp::LuaLibs;
+using lpp::LuaState;
+using lpp::LuaStateOptions;
+
+static const uint64_t ITERATIONS = 10000;
+
+
+static void create_states(bench::Run& run, const LuaStateOptions& options)
+{
+    run.measure([&](uint64_t) {
+        LuaState lua(options);
+        bench::keep(lua);
+    });
+}
+
+static bench::Registrar r1("LuaState creation: all libraries", ITERATIONS,
+                           [](bench::Run& run) {
+    create_states(run, LuaStateOptions());
+});
+static bench::Registrar r2("LuaState creation: base library", ITERATIONS,
+                           [](bench::Run& run) {
+    LuaStateOptions options;
+    options.libs = LuaLibs::base;
+    create_states(run, options);
+});
+static bench::Registrar r3("LuaState creation: lazy libraries", ITERATIONS,
+                           [](bench::Run& run) {
+    LuaStateOptions options;
+    options.lazy_libs = true;
+    create_states(run, options);
+});
@@ -0,0 +1,24 @@
+#include <cstring>
+#include <iostream>
+#include <Benchmark.h>
+
+
+// Usage: lua++_bench [filter], only runs benchmarks containing 'filter'.
+int main(int argc, char** argv)
+{
+    const char* filter = argc > 1 ? argv[1] : "";
+
+    for (const auto& b : bench::benchmarks())
+    {
+        if (std::strstr(b.name, filter) == nullptr) { continue; }
+
+        bench::Run run(b.iterations);
+        b.function(run);
+        auto ns = static_cast<double>(run.elapsed().count());
+        std::cout << b.name << ": "
+                  << ns / static_cast<double>(run.iterations()) << " ns/op ("
+                  << run.iterations() << " iterations)\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include <algorithm>
+#include <LuaState.h>
+#include <Benchmark.h>
+
+
+using lpp::LuaState;
+
+static const char* const SCRIPT = "bench/string_bench.lua";
+static const uint64_t ITERATIONS = 1000;
+static const int32_t CALLS_PER_ITERATION = 100;
+static const size_t PAYLOAD_SIZE = 8 * 1024;
+
+size_t count_copy(std::string payload);
+size_t count_view(std::string_view payload);
+
+
+size_t count_copy(std::string payload)
+{
+    return static_cast<size_t>(std::count(payload.begin(), payload.end(), ','));
+}
+
+size_t count_view(std::string_view payload)
+{
+    return static_cast<size_t>(std::count(payload.begin(), payload.end(), ','));
+}
+
+static void run_payload(bench::Run& run, std::string&& func_name)
+{
+    LuaState lua;
+    lua.export_function(count_copy, "count_copy");
+    lua.export_function(count_view, "count_view");
+    auto f = lua.import_function_from(SCRIPT)
+                .with_name(std::move(func_name))
+                .with_return_type<size_t>()
+                .with_params<std::string, int32_t>()
+                .build();
+    std::string payload(PAYLOAD_SIZE, 'x');
+    for (size_t i = 0; i < payload.size(); i += 16) { payload[i] = ','; }
+
+    run.measure([&](uint64_t) {
+        bench::keep(f(payload, CALLS_PER_ITERATION));
+    });
+}
+
+static bench::Registrar r1("8 KiB string parameter x100, std::string", ITERATIONS,
+                           [](bench::Run& run) { run_payload(run, "count_copy_n"); });
+static bench::Registrar r2("8 KiB string parameter x100, std::string_view", ITERATIONS,
+                           [](bench::Run& run) { run_payload(run, "count_view_n"); });
@@ -0,0 +1,11 @@
+function count_copy_n(payload, n)
+    local total = 0
+    for _ = 1, n do total = total + count_copy(payload) end
+    return total
+end
+
+function count_view_n(payload, n)
+    local total = 0
+    for _ = 1, n do total = total + count_view(payload) end
+    return total
+end
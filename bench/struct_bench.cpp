@@ -0,0 +1,84 @@
+#include <lua.hpp>
+#include <LuaStackHelpers.hpp>
+#include <Benchmark.h>
+
+
+static const uint64_t ITERATIONS = 100000;
+
+struct Record
+{
+    int64_t id;
+    int64_t timestamp;
+    double value;
+    double threshold;
+    bool active;
+    std::string source;
+};
+
+namespace lpp
+{
+    template <>
+    struct LuaStruct<Record>
+    {
+        static constexpr auto fields = std::make_tuple(
+            lua_field("id", &Record::id),
+            lua_field("timestamp", &Record::timestamp),
+            lua_field("value", &Record::value),
+            lua_field("threshold", &Record::threshold),
+            lua_field("active", &Record::active),
+            lua_field("source", &Record::source));
+    };
+}
+
+// Pushing a struct by hand, creating the key strings again every time.
+static void push_naive(lua_State* plua, const Record& record)
+{
+    lua_newtable(plua);
+    lua_pushinteger(plua, record.id);
+    lua_setfield(plua, -2, "id");
+    lua_pushinteger(plua, record.timestamp);
+    lua_setfield(plua, -2, "timestamp");
+    lua_pushnumber(plua, record.value);
+    lua_setfield(plua, -2, "value");
+    lua_pushnumber(plua, record.threshold);
+    lua_setfield(plua, -2, "threshold");
+    lua_pushboolean(plua, record.active);
+    lua_setfield(plua, -2, "active");
+    lua_pushlstring(plua, record.source.data(), record.source.size());
+    lua_setfield(plua, -2, "source");
+}
+
+static void run_push(bench::Run& run, bool interned)
+{
+    lua_State* plua = luaL_newstate();
+    Record record{ 1, 1500000000, 3.5, 10.0, true, "sensor" };
+
+    run.measure([&](uint64_t i) {
+        record.id = static_cast<int64_t>(i);
+        if (interned) { lpp::push_on_stack(plua, record); }
+        else { push_naive(plua, record); }
+        lua_pop(plua, 1);
+    });
+
+    lua_close(plua);
+}
+
+static void run_get(bench::Run& run)
+{
+    lua_State* plua = luaL_newstate();
+    lpp::push_on_stack(plua, Record{ 1, 1500000000, 3.5, 10.0, true, "sensor" });
+
+    run.measure([&](uint64_t) {
+        Record record = lpp::LuaStackGetter(plua, -1);
+        bench::keep(record.id);
+    });
+
+    lua_close(plua);
+}
+
+static bench::Registrar r1("push 6 field struct, lua_setfield", ITERATIONS,
+                           [](bench::Run& run) { run_push(run, false); });
+static bench::Registrar r2("push 6 field struct, interned names", ITERATIONS,
+                           [](bench::Run& run) { run_push(run, true); });
+static bench::Registrar r3("get 6 field struct", ITERATIONS,
+                           [](bench::Run& run) { run_get(run); });
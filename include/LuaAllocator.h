@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+
+
+namespace lpp
+{
+    /**
+     * Interface for allocators used by a Lua instance.
+     * All memory Lua allocates goes through 'reallocate', see lua_Alloc.
+     */
+    class LuaAllocator
+    {
+    public:
+        LuaAllocator() = default;
+        LuaAllocator(const LuaAllocator&) = delete;
+        LuaAllocator& operator=(const LuaAllocator&) = delete;
+        virtual ~LuaAllocator();
+
+        /**
+         * Allocates (ptr == nullptr), resizes or frees (new_size == 0) a
+         * block of memory. 'old_size' is the size the block was allocated
+         * with, or 0 for new allocations. Returns nullptr if the request
+         * can't be fulfilled, in which case the old block remains valid.
+         * Shrinking and freeing memory never fails.
+         */
+        virtual void* reallocate(void* ptr,
+                                 size_t old_size,
+                                 size_t new_size) noexcept = 0;
+
+        /**
+         * lua_Alloc compatible function, expects a LuaAllocator as user data.
+         */
+        static void* allocate(void* pallocator,
+                              void* ptr,
+                              size_t old_size,
+                              size_t new_size) noexcept;
+    };
+
+    /**
+     * Allocator using realloc and free, the same as luaL_newstate does.
+     */
+    class LuaDefaultAllocator : public LuaAllocator
+    {
+    public:
+        void* reallocate(void* ptr,
+                         size_t old_size,
+                         size_t new_size) noexcept override;
+    };
+}
@@ -0,0 +1,262 @@
+#pragma once
+#include <assert.h>
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <lua.hpp>
+#include <LuaStackHelpers.hpp>
+
+
+namespace lpp
+{
+    /**
+     * A call of an async C++ function a Lua coroutine is waiting for.
+     * The coroutine yields the address of 'key' and the call itself, so
+     * whoever resumes it can tell it apart from a coroutine.yield in Lua.
+     */
+    class LuaAsyncCall
+    {
+    public:
+        static inline const char key = 0;
+
+        virtual ~LuaAsyncCall() = default;
+
+        /**
+         * Waits at most 'timeout' for the result, returns true if it is
+         * available.
+         */
+        virtual bool wait_for(std::chrono::nanoseconds timeout) const = 0;
+
+        virtual void wait() const = 0;
+
+        bool is_ready() const
+        {
+            return wait_for(std::chrono::nanoseconds::zero());
+        }
+    };
+
+    /**
+     * Async call whose result is a std::future, stored inline in a full
+     * userdata on the stack of the calling coroutine.
+     */
+    template <typename ReturnType>
+    class LuaFutureCall final : public LuaAsyncCall
+    {
+    public:
+        explicit LuaFutureCall(std::future<ReturnType>&& future)
+            : m_future(std::move(future)) {}
+
+        bool wait_for(std::chrono::nanoseconds timeout) const override
+        {
+            // A deferred future runs once its result is asked for
+            return m_future.wait_for(timeout) != std::future_status::timeout;
+        }
+
+        void wait() const override
+        {
+            m_future.wait();
+        }
+
+        /**
+         * Pushes the result of the call, or CPP_ERROR if it failed (see
+         * forward_results).
+         */
+        int push_result(lua_State* plua)
+        {
+            try
+            {
+                if constexpr (std::is_void<ReturnType>::value)
+                {
+                    m_future.get();
+                    return 0;
+                }
+                else
+                {
+                    ReturnType result = m_future.get();
+                    return push_results_protected(plua, result);
+                }
+            }
+            catch (const std::exception& e)
+            {
+                push_error_message(plua, e.what());
+            }
+            catch (...)
+            {
+                push_error_message(plua, "unknown C++ exception");
+            }
+            return CPP_ERROR;
+        }
+
+    private:
+        std::future<ReturnType> m_future;
+    };
+
+
+    /**
+     * Lua threads whose resumer handles async calls, the ones created by
+     * LuaCoroutine. Any other coroutine (coroutine.wrap in Lua) would pass
+     * the yielded call on to the script, so it waits for the result
+     * instead. Kept as keys of a weak table in the registry, using the
+     * address of 'key' as registry key.
+     */
+    struct LuaAsyncThreads
+    {
+        static inline const char key = 0;
+
+        static void add(lua_State* pthread)
+        {
+            if (lua_rawgetp(pthread, LUA_REGISTRYINDEX, &key) != LUA_TTABLE)
+            {
+                lua_pop(pthread, 1);
+                lua_newtable(pthread);
+                lua_createtable(pthread, 0, 1);
+                lua_pushliteral(pthread, "k");
+                lua_setfield(pthread, -2, "__mode");
+                lua_setmetatable(pthread, -2);
+                lua_pushvalue(pthread, -1);
+                lua_rawsetp(pthread, LUA_REGISTRYINDEX, &key);
+            }
+            lua_pushthread(pthread);
+            lua_pushboolean(pthread, 1);
+            lua_rawset(pthread, -3);
+            lua_pop(pthread, 1);
+        }
+
+        static bool contains(lua_State* pthread)
+        {
+            if (lua_rawgetp(pthread, LUA_REGISTRYINDEX, &key) != LUA_TTABLE)
+            {
+                lua_pop(pthread, 1);
+                return false;
+            }
+            lua_pushthread(pthread);
+            bool found = lua_rawget(pthread, -2) != LUA_TNIL;
+            lua_pop(pthread, 2);
+            return found;
+        }
+    };
+
+
+    // Returned by start_async_call when the coroutine has to yield
+    constexpr int ASYNC_YIELD = -2;
+
+    /**
+     * Calls f with the arguments on the stack and pushes the future it
+     * returns as a LuaFutureCall. Inside a coroutine created by LuaCoroutine,
+     * ASYNC_YIELD is returned. Elsewhere nothing can run in the meantime,
+     * so the result is waited for and pushed right away.
+     */
+    template <LuaArgPolicy Policy, typename ReturnType, typename... ParamTypes,
+              typename Function, size_t... Is>
+    int start_async_call(lua_State* plua_state, Function& f, std::index_sequence<Is...>)
+    {
+        using Call = LuaFutureCall<ReturnType>;
+        static_assert(alignof(Call) <= std::max(alignof(lua_Number), alignof(void*)),
+                      "Lua userdata is not aligned enough for this call!");
+
+        try
+        {
+            if constexpr (Policy == LuaArgPolicy::strict)
+            {
+                check_arg_count(plua_state, static_cast<int>(sizeof...(ParamTypes)));
+            }
+            const bool can_yield = lua_isyieldable(plua_state)
+                                && LuaAsyncThreads::contains(plua_state);
+
+            // Allocated before f runs, so no future is alive when Lua raises
+            // a memory error. The metatable (and __gc with it) is only set
+            // once the call is constructed.
+            void* pmemory = lua_newuserdata(plua_state, sizeof(Call));
+            LuaCallableMetatable<Call>::push(plua_state);
+            auto pcall = new (pmemory) Call(f(get_arg<Policy, std::decay_t<ParamTypes>>(
+                                                  plua_state, static_cast<int>(Is) + 1)...));
+            lua_setmetatable(plua_state, -2);
+
+            if (!can_yield)
+            {
+                return pcall->push_result(plua_state);
+            }
+            return ASYNC_YIELD;
+        }
+        catch (const std::exception& e)
+        {
+            push_error_message(plua_state, e.what());
+        }
+        catch (...)
+        {
+            push_error_message(plua_state, "unknown C++ exception");
+        }
+        return CPP_ERROR;
+    }
+
+    /**
+     * Continuation of an async C++ function, runs when its coroutine is
+     * resumed. 'ctx' is the stack position of the LuaFutureCall.
+     */
+    template <typename ReturnType>
+    int finish_async_call(lua_State* plua_state, int, lua_KContext ctx)
+    {
+        auto pcall = static_cast<LuaFutureCall<ReturnType>*>(
+                         lua_touserdata(plua_state, static_cast<int>(ctx)));
+        return forward_results(plua_state, pcall->push_result(plua_state));
+    }
+
+    template <LuaArgPolicy Policy, typename Callable, typename ReturnType, typename... ParamTypes>
+    int do_call_async(lua_State* plua_state)
+    {
+        auto& f = *static_cast<Callable*>(lua_touserdata(plua_state, lua_upvalueindex(1)));
+        int results = start_async_call<Policy, ReturnType, ParamTypes...>(
+                          plua_state, f, std::index_sequence_for<ParamTypes...>{});
+        if (results != ASYNC_YIELD)
+        {
+            return forward_results(plua_state, results);
+        }
+
+        // The call stays on the stack of this function while it is
+        // suspended, the resumer gets the marker and the call.
+        const int call_location = lua_gettop(plua_state);
+        auto pcall = static_cast<LuaAsyncCall*>(static_cast<LuaFutureCall<ReturnType>*>(
+                         lua_touserdata(plua_state, call_location)));
+        lua_pushlightuserdata(plua_state, const_cast<char*>(&LuaAsyncCall::key));
+        lua_pushlightuserdata(plua_state, pcall);
+        return lua_yieldk(plua_state, 2, call_location, &finish_async_call<ReturnType>);
+    }
+
+    /**
+     * Signature of a function pointer, lambda or functor.
+     */
+    template <typename Callable>
+    using LuaSignatureOf = typename std::conditional_t<
+        std::is_class<std::decay_t<Callable>>::value,
+        LuaCallableTraits<std::decay_t<Callable>>,
+        LuaFunctionTraits<std::decay_t<Callable>>>::Signature;
+
+    // Helper function to export an async C++ function to Lua, the function
+    // (pointer) is moved into a userdata used as upvalue.
+    template <LuaArgPolicy Policy, typename Callable, typename ReturnType, typename... ParamTypes>
+    void export_async_helper(lua_State* plua_state,
+                             Callable&& f,
+                             std::string&& lua_function_name,
+                             LuaSignature<std::future<ReturnType>, ParamTypes...>)
+    {
+        using Stored = std::decay_t<Callable>;
+        static_assert(alignof(Stored) <= std::max(alignof(lua_Number), alignof(void*)),
+                      "Lua userdata is not aligned enough for this callable!");
+        assert(plua_state && "Lua state not allowed to be nullptr!");
+
+        void* pmemory = lua_newuserdata(plua_state, sizeof(Stored));
+        new (pmemory) Stored(std::forward<Callable>(f));
+        if constexpr (!std::is_trivially_destructible<Stored>::value)
+        {
+            LuaCallableMetatable<Stored>::push(plua_state);
+            lua_setmetatable(plua_state, -2);
+        }
+        lua_pushcclosure(plua_state, &do_call_async<Policy, Stored, ReturnType, ParamTypes...>, 1);
+        lua_setglobal(plua_state, lua_function_name.c_str());
+    }
+}
@@ -0,0 +1,232 @@
+#pragma once
+#include <assert.h>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <lua.hpp>
+
+#if __has_include(<span>)
+#include <span>
+#endif
+
+
+namespace lpp
+{
+    /**
+     * Typed view on a contiguous block of numbers, passed to Lua as userdata
+     * without copying the elements. Lua can index it (buf[i], 1-based),
+     * assign elements and get its length (#buf).
+     *
+     * A borrowed buffer points to memory owned by C++, which has to outlive
+     * every use of the buffer in Lua. An owned buffer keeps its elements
+     * alive itself, they are shared between all copies of the buffer.
+     */
+    template <typename T>
+    class LuaBuffer
+    {
+        static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value,
+                      "LuaBuffer only supports numeric element types!");
+
+    public:
+        LuaBuffer()
+            : m_pdata(nullptr)
+            , m_size(0) {}
+
+        /**
+         * Borrows 'size' elements starting at 'pdata'.
+         */
+        LuaBuffer(T* pdata, size_t size)
+            : m_pdata(pdata)
+            , m_size(size) {}
+
+#ifdef __cpp_lib_span
+        /**
+         * Borrows the elements of a span.
+         */
+        LuaBuffer(std::span<T> values)
+            : m_pdata(values.data())
+            , m_size(values.size()) {}
+#endif
+
+        /**
+         * Takes ownership of the elements of a vector.
+         */
+        explicit LuaBuffer(std::vector<T>&& values)
+            : m_pstorage(std::make_shared<std::vector<T>>(std::move(values)))
+        {
+            m_pdata = m_pstorage->data();
+            m_size = m_pstorage->size();
+        }
+
+        T* data() const { return m_pdata; }
+        size_t size() const { return m_size; }
+        bool is_owned() const { return m_pstorage != nullptr; }
+#ifdef __cpp_lib_span
+        std::span<T> span() const { return { m_pdata, m_size }; }
+#endif
+
+        T& operator[](size_t i) const { return m_pdata[i]; }
+        T* begin() const { return m_pdata; }
+        T* end() const { return m_pdata + m_size; }
+
+    private:
+        T* m_pdata;
+        size_t m_size;
+        std::shared_ptr<std::vector<T>> m_pstorage;
+    };
+
+
+    template <typename T>
+    LuaBuffer<T>* to_lua_buffer(lua_State* plua, int location);
+
+    /**
+     * Metatable shared by all LuaBuffers with the same element type.
+     * Created once per Lua instance and stored in the registry, using the
+     * address of 'key' as registry key.
+     */
+    template <typename T>
+    struct LuaBufferMetatable
+    {
+        static inline const char key = 0;
+
+        static void push(lua_State* plua)
+        {
+            if (lua_rawgetp(plua, LUA_REGISTRYINDEX, &key) != LUA_TNIL) { return; }
+            lua_pop(plua, 1);
+
+            lua_createtable(plua, 0, 5);
+            lua_pushboolean(plua, 0);
+            lua_setfield(plua, -2, "__metatable");  // Hidden from scripts
+            lua_pushcfunction(plua, &index);
+            lua_setfield(plua, -2, "__index");
+            lua_pushcfunction(plua, &new_index);
+            lua_setfield(plua, -2, "__newindex");
+            lua_pushcfunction(plua, &length);
+            lua_setfield(plua, -2, "__len");
+            lua_pushcfunction(plua, &gc);
+            lua_setfield(plua, -2, "__gc");
+            lua_pushvalue(plua, -1);
+            lua_rawsetp(plua, LUA_REGISTRYINDEX, &key);
+        }
+
+        static int index(lua_State* plua)
+        {
+            auto pbuffer = check_buffer(plua);
+            int is_integer = 0;
+            lua_Integer i = lua_tointegerx(plua, 2, &is_integer);
+            if (!is_integer || i < 1 || static_cast<size_t>(i) > pbuffer->size())
+            {
+                return 0;
+            }
+
+            if constexpr (std::is_integral<T>::value)
+            {
+                lua_pushinteger(plua, static_cast<lua_Integer>((*pbuffer)[i - 1]));
+            }
+            else
+            {
+                lua_pushnumber(plua, static_cast<lua_Number>((*pbuffer)[i - 1]));
+            }
+            return 1;
+        }
+
+        static int new_index(lua_State* plua)
+        {
+            auto pbuffer = check_buffer(plua);
+            int is_integer = 0;
+            lua_Integer i = lua_tointegerx(plua, 2, &is_integer);
+            if (!is_integer || i < 1 || static_cast<size_t>(i) > pbuffer->size())
+            {
+                return luaL_error(plua, "buffer index out of range");
+            }
+
+            int is_number = 0;
+            T value;
+            if constexpr (std::is_integral<T>::value)
+            {
+                value = static_cast<T>(lua_tointegerx(plua, 3, &is_number));
+            }
+            else
+            {
+                value = static_cast<T>(lua_tonumberx(plua, 3, &is_number));
+            }
+            if (!is_number)
+            {
+                return luaL_error(plua, "invalid value for buffer element");
+            }
+            (*pbuffer)[i - 1] = value;
+            return 0;
+        }
+
+        static int length(lua_State* plua)
+        {
+            auto pbuffer = check_buffer(plua);
+            lua_pushinteger(plua, static_cast<lua_Integer>(pbuffer->size()));
+            return 1;
+        }
+
+        static int gc(lua_State* plua)
+        {
+            auto pbuffer = to_lua_buffer<T>(plua, 1);
+            if (!pbuffer) { return 0; }  // Not a buffer (anymore)
+            pbuffer->~LuaBuffer<T>();
+            lua_pushnil(plua);
+            lua_setmetatable(plua, 1);  // Destroyed, no buffer anymore
+            return 0;
+        }
+
+        static LuaBuffer<T>* check_buffer(lua_State* plua)
+        {
+            auto pbuffer = to_lua_buffer<T>(plua, 1);
+            if (!pbuffer) { luaL_argerror(plua, 1, "buffer expected"); }
+            return pbuffer;
+        }
+    };
+
+
+    /**
+     * Pushes a buffer onto the Lua stack as userdata, the elements are not
+     * copied.
+     */
+    template <typename T>
+    void push_on_stack(lua_State* plua, const LuaBuffer<T>& buffer)
+    {
+        assert(plua);
+        // Everything that can raise a memory error is done before the
+        // buffer is constructed, so it always gets its __gc.
+        void* pmemory = lua_newuserdata(plua, sizeof(LuaBuffer<T>));
+        LuaBufferMetatable<T>::push(plua);
+        new (pmemory) LuaBuffer<T>(buffer);
+        lua_setmetatable(plua, -2);
+    }
+
+#ifdef __cpp_lib_span
+    /**
+     * Pushes a span onto the Lua stack as a borrowed buffer.
+     */
+    template <typename T>
+    void push_on_stack(lua_State* plua, std::span<T> values)
+    {
+        push_on_stack(plua, LuaBuffer<T>(values));
+    }
+#endif
+
+    /**
+     * Gets the buffer at a certain position of the Lua stack, or nullptr if
+     * the element is not a buffer with element type T.
+     */
+    template <typename T>
+    LuaBuffer<T>* to_lua_buffer(lua_State* plua, int location)
+    {
+        void* pmemory = lua_touserdata(plua, location);
+        if (!pmemory || !lua_getmetatable(plua, location)) { return nullptr; }
+
+        LuaBufferMetatable<T>::push(plua);
+        bool is_buffer = lua_rawequal(plua, -1, -2);
+        lua_pop(plua, 2);
+        return is_buffer ? static_cast<LuaBuffer<T>*>(pmemory) : nullptr;
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <lua.hpp>
+
+
+namespace lpp
+{
+    /**
+     * Opt-in on-disk cache of precompiled Lua chunks.
+     * Compiled chunks are dumped into a cache directory, keyed by a hash of
+     * their source code and chunk name, and loaded back in binary mode when the source did
+     * not change. Stale or corrupt cache entries are rejected and replaced.
+     */
+    class LuaBytecodeCache
+    {
+    public:
+        LuaBytecodeCache(const std::string& cache_dir,
+                         bool strip_debug_info = false);
+
+        /**
+         * Loads a Lua script and pushes it on the stack as a function, using
+         * the cached bytecode when possible. Behaves like luaL_loadfile:
+         * returns a Lua status code and pushes an error message on failure.
+         */
+        int load_file(lua_State* plua, const std::string& script_path) const;
+
+        /**
+         * Directory in which the compiled chunks are stored.
+         */
+        const std::string& directory() const;
+
+        /**
+         * Whether debug info (line numbers, local names) is stripped from
+         * the cached chunks.
+         */
+        bool strips_debug_info() const;
+
+    private:
+        std::string m_cache_dir;
+        bool m_strip_debug_info;
+
+        // Helper functions:
+
+        bool load_cached(lua_State* plua, const std::string& entry_path,
+                         const std::string& chunk_name,
+                         uint64_t source_hash, uint64_t source_size) const;
+        void store(lua_State* plua, const std::string& entry_path,
+                   uint64_t source_hash, uint64_t source_size) const;
+    };
+}
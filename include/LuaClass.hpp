@@ -0,0 +1,280 @@
+#pragma once
+#include <assert.h>
+#include <exception>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <lua.hpp>
+#include <LuaObject.hpp>
+#include <LuaStackHelpers.hpp>
+
+
+namespace lpp
+{
+    /**
+     * Builder for exposing a C++ class to Lua. Objects live inline in full
+     * userdata and are destroyed by the garbage collector.
+     *
+     * The class is available in Lua as a global table with the given name,
+     * objects are created with <name>.new(...) once a constructor is
+     * registered. Methods are called as obj:method(...), properties are
+     * accessed as obj.property.
+     */
+    template <typename T>
+    class LuaClass
+    {
+    public:
+        LuaClass(lua_State* plua, std::string&& name)
+            : m_plua(plua)
+            , m_name(std::move(name))
+        {
+            assert(plua);
+            LuaClassMetatable<T>::push(m_plua);
+            lua_pushstring(m_plua, m_name.c_str());
+            lua_setfield(m_plua, -2, "__name");  // Used by tostring(obj)
+            lua_pop(m_plua, 1);
+
+            lua_newtable(m_plua);
+            lua_setglobal(m_plua, m_name.c_str());
+        }
+
+        /**
+         * Registers <name>.new(...), constructing an object with the given
+         * parameter types.
+         */
+        template <typename... ParamTypes>
+        LuaClass& constructor()
+        {
+            lua_getglobal(m_plua, m_name.c_str());
+            lua_pushcfunction(m_plua, &construct<ParamTypes...>);
+            lua_setfield(m_plua, -2, "new");
+            lua_pop(m_plua, 1);
+            return *this;
+        }
+
+        template <typename ReturnType, typename... ParamTypes>
+        LuaClass& method(const char* name, ReturnType (T::*f)(ParamTypes...))
+        {
+            add_method<decltype(f), ReturnType, ParamTypes...>(name, f);
+            return *this;
+        }
+
+        template <typename ReturnType, typename... ParamTypes>
+        LuaClass& method(const char* name, ReturnType (T::*f)(ParamTypes...) const)
+        {
+            add_method<decltype(f), ReturnType, ParamTypes...>(name, f);
+            return *this;
+        }
+
+        /**
+         * Registers a data member that can be read and assigned in Lua.
+         */
+        template <typename MemberType>
+        LuaClass& property(const char* name, MemberType T::* member)
+        {
+            add_property(name, member, true);
+            return *this;
+        }
+
+        template <typename MemberType>
+        LuaClass& readonly_property(const char* name, MemberType T::* member)
+        {
+            add_property(name, member, false);
+            return *this;
+        }
+
+    private:
+        lua_State* m_plua;
+        std::string m_name;
+
+        // Helper functions:
+
+        // Member pointers do not fit in light userdata, they are copied into
+        // a full userdata used as upvalue instead.
+        template <typename MemberPointer>
+        void push_member_pointer(MemberPointer ptr)
+        {
+            void* pmemory = lua_newuserdata(m_plua, sizeof(MemberPointer));
+            new (pmemory) MemberPointer(ptr);
+        }
+
+        template <typename MemberPointer>
+        static MemberPointer get_member_pointer(lua_State* plua)
+        {
+            return *static_cast<MemberPointer*>(lua_touserdata(plua, lua_upvalueindex(1)));
+        }
+
+        static T& get_self(lua_State* plua)
+        {
+            T* pself = to_lua_object<T>(plua, 1);
+            if (!pself) { luaL_argerror(plua, 1, "object expected"); }
+            return *pself;
+        }
+
+        template <typename Method, typename ReturnType, typename... ParamTypes>
+        void add_method(const char* name, Method f)
+        {
+            LuaClassMetatable<T>::push(m_plua);
+            lua_rawgetp(m_plua, -1, &LuaClassMetatable<T>::methods_key);
+            push_member_pointer(f);
+            lua_pushcclosure(m_plua, &call_method<Method, ReturnType, ParamTypes...>, 1);
+            lua_setfield(m_plua, -2, name);
+            lua_pop(m_plua, 2);
+        }
+
+        template <typename MemberType>
+        void add_property(const char* name, MemberType T::* member, bool writable)
+        {
+            LuaClassMetatable<T>::push(m_plua);
+            lua_rawgetp(m_plua, -1, &LuaClassMetatable<T>::getters_key);
+            push_member_pointer(member);
+            lua_pushcclosure(m_plua, &get_property<MemberType>, 1);
+            lua_setfield(m_plua, -2, name);
+            lua_pop(m_plua, 1);
+
+            if (writable)
+            {
+                lua_rawgetp(m_plua, -1, &LuaClassMetatable<T>::setters_key);
+                push_member_pointer(member);
+                lua_pushcclosure(m_plua, &set_property<MemberType>, 1);
+                lua_setfield(m_plua, -2, name);
+                lua_pop(m_plua, 1);
+            }
+
+            // The methods table alone is no longer enough for __index, look
+            // in the methods first and in the getters second (in one step,
+            // instead of chaining the tables with another __index).
+            if (lua_getfield(m_plua, -1, "__index") == LUA_TTABLE)
+            {
+                lua_rawgetp(m_plua, -2, &LuaClassMetatable<T>::getters_key);
+                lua_pushcclosure(m_plua, &LuaClassMetatable<T>::index, 2);
+                lua_setfield(m_plua, -2, "__index");
+            }
+            else
+            {
+                lua_pop(m_plua, 1);
+            }
+            lua_pop(m_plua, 1);
+        }
+
+        template <typename... ParamTypes>
+        static int construct(lua_State* plua)
+        {
+            return forward_results(plua, do_construct<ParamTypes...>(
+                                             plua, std::index_sequence_for<ParamTypes...>{}));
+        }
+
+        template <typename... ParamTypes, size_t... Is>
+        static int do_construct(lua_State* plua, std::index_sequence<Is...>)
+        {
+            try
+            {
+                push_lua_object<T>(plua, get_value<std::decay_t<ParamTypes>>(
+                                             plua, static_cast<int>(Is) + 1)...);
+                return 1;
+            }
+            catch (const std::exception& e)
+            {
+                push_error_message(plua, e.what());
+            }
+            catch (...)
+            {
+                push_error_message(plua, "unknown C++ exception");
+            }
+            return CPP_ERROR;
+        }
+
+        template <typename Method, typename ReturnType, typename... ParamTypes>
+        static int call_method(lua_State* plua)
+        {
+            return forward_results(plua, do_call_method<Method, ReturnType, ParamTypes...>(
+                                             plua, std::index_sequence_for<ParamTypes...>{}));
+        }
+
+        template <typename Method, typename ReturnType, typename... ParamTypes, size_t... Is>
+        static int do_call_method(lua_State* plua, std::index_sequence<Is...>)
+        {
+            auto f = get_member_pointer<Method>(plua);
+            T& self = get_self(plua);
+            try
+            {
+                // Arguments start after self
+                if constexpr (std::is_void<ReturnType>::value)
+                {
+                    (self.*f)(get_value<std::decay_t<ParamTypes>>(plua, static_cast<int>(Is) + 2)...);
+                    return 0;
+                }
+                else
+                {
+                    const auto& result = (self.*f)(get_value<std::decay_t<ParamTypes>>(
+                                                       plua, static_cast<int>(Is) + 2)...);
+                    return push_results_protected(plua, result);
+                }
+            }
+            catch (const std::exception& e)
+            {
+                push_error_message(plua, e.what());
+            }
+            catch (...)
+            {
+                push_error_message(plua, "unknown C++ exception");
+            }
+            return CPP_ERROR;
+        }
+
+        template <typename MemberType>
+        static int get_property(lua_State* plua)
+        {
+            return forward_results(plua, do_get_property<MemberType>(plua));
+        }
+
+        template <typename MemberType>
+        static int do_get_property(lua_State* plua)
+        {
+            auto member = get_member_pointer<MemberType T::*>(plua);
+            T& self = get_self(plua);
+            try
+            {
+                push_on_stack(plua, self.*member);
+                return 1;
+            }
+            catch (const std::exception& e)
+            {
+                push_error_message(plua, e.what());
+            }
+            catch (...)
+            {
+                push_error_message(plua, "unknown C++ exception");
+            }
+            return CPP_ERROR;
+        }
+
+        template <typename MemberType>
+        static int set_property(lua_State* plua)
+        {
+            return forward_results(plua, do_set_property<MemberType>(plua));
+        }
+
+        template <typename MemberType>
+        static int do_set_property(lua_State* plua)
+        {
+            auto member = get_member_pointer<MemberType T::*>(plua);
+            T& self = get_self(plua);
+            try
+            {
+                self.*member = get_value<MemberType>(plua, 2);
+                return 0;
+            }
+            catch (const std::exception& e)
+            {
+                push_error_message(plua, e.what());
+            }
+            catch (...)
+            {
+                push_error_message(plua, "unknown C++ exception");
+            }
+            return CPP_ERROR;
+        }
+    };
+}
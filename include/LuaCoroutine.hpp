@@ -0,0 +1,193 @@
+#pragma once
+#include <assert.h>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <lua.hpp>
+#include <LuaAsync.hpp>
+#include <LuaError.h>
+#include <LuaStack.h>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define LPP_HAS_COROUTINES 1
+#endif
+
+
+namespace lpp
+{
+    template <typename T, typename... Ts>
+    class LuaCoroutineTask;
+    template <typename T, typename... Ts>
+    class LuaResumeTask;
+    template <typename T, typename... Ts>
+    class LuaResumeAwaiter;
+
+    /**
+     * A Lua function running in its own Lua thread, which can be suspended
+     * (coroutine.yield in Lua) and resumed from C++. The thread shares the
+     * globals of the Lua instance it was created in.
+     *
+     * T is the type of the values the function yields and returns, Ts are
+     * the types passed to resume: the arguments of the function on the
+     * first resume, the results of coroutine.yield after that.
+     *
+     * Async C++ functions (see LuaStack::export_async_function) suspend the
+     * coroutine until their result is available. resume waits for them,
+     * a LuaScheduler runs other coroutines in the meantime instead. C++20
+     * coroutines await it through LuaScheduler::resume.
+     */
+    template <typename T, typename... Ts>
+    class LuaCoroutine
+    {
+        static_assert(!is_lua_string_view<T>,
+                      "Results are popped of the stack, the view would dangle. "
+                      "Use std::string instead.");
+
+    public:
+        /**
+         * Pops the function on top of the stack and creates a coroutine
+         * running it.
+         */
+        explicit LuaCoroutine(const std::shared_ptr<LuaStack>& stack)
+            : m_pstack(stack)
+        {
+            assert(m_pstack);
+            m_pthread = m_pstack->new_thread();
+            LuaAsyncThreads::add(m_pthread);
+            m_ref = m_pstack->make_ref();  // Keeps the thread alive
+        }
+        LuaCoroutine(const LuaCoroutine& other) = delete;
+        LuaCoroutine& operator=(const LuaCoroutine& other) = delete;
+        LuaCoroutine(LuaCoroutine&& other) noexcept
+            : m_pstack(other.m_pstack)
+            , m_pthread(other.m_pthread)
+            , m_ref(other.m_ref)
+            , m_finished(other.m_finished)
+            , m_pwaiting(other.m_pwaiting)
+        {
+            other.m_ref = LUA_NOREF;
+            other.m_finished = true;
+        }
+        LuaCoroutine& operator=(LuaCoroutine&& other) noexcept
+        {
+            if (this != &other)
+            {
+                m_pstack->release_ref(m_ref);
+                m_pstack = other.m_pstack;
+                m_pthread = other.m_pthread;
+                m_ref = other.m_ref;
+                m_finished = other.m_finished;
+                m_pwaiting = other.m_pwaiting;
+                other.m_ref = LUA_NOREF;
+                other.m_finished = true;
+            }
+            return *this;
+        }
+        ~LuaCoroutine()
+        {
+            m_pstack->release_ref(m_ref);
+        }
+
+        /**
+         * Runs the coroutine until it yields or returns, and gets the values
+         * it yielded or returned. Raises a LuaError if the function raises
+         * an error or already finished, the coroutine can not be resumed
+         * after that.
+         */
+        T resume(const Ts&... args)
+        {
+            push_args(args...);
+            bool has_values = resume_thread(sizeof...(Ts));
+            while (!has_values)
+            {
+                m_pwaiting->wait();
+                has_values = resume_thread(0);
+            }
+            return take_results();
+        }
+
+        /**
+         * True once the function returned or raised an error.
+         */
+        bool is_finished() const
+        {
+            return m_finished;
+        }
+
+    private:
+        std::shared_ptr<LuaStack> m_pstack;
+        lua_State* m_pthread;
+        int m_ref;  // Registry reference to the thread
+        bool m_finished = false;
+        LuaAsyncCall* m_pwaiting = nullptr;  // Async call the thread waits for
+
+        friend class LuaCoroutineTask<T, Ts...>;
+        friend class LuaResumeTask<T, Ts...>;
+        friend class LuaResumeAwaiter<T, Ts...>;
+
+        // Helper functions:
+
+        void push_args(const Ts&... args)
+        {
+            if (m_finished)
+            {
+                throw LuaError("cannot resume dead coroutine");
+            }
+            if (!lua_checkstack(m_pthread, static_cast<int>(sizeof...(Ts))))
+            {
+                throw LuaError("stack overflow");
+            }
+            (push_on_stack(m_pthread, args), ...);
+        }
+
+        /**
+         * Resumes the thread with the top 'param_amount' values on its
+         * stack. Returns false if it is waiting for an async call, true if
+         * it yielded or returned values.
+         */
+        bool resume_thread(int param_amount)
+        {
+            int status = m_pstack->resume(m_pthread, param_amount);
+            m_pwaiting = nullptr;
+            if (status == LUA_YIELD)
+            {
+                if (lua_gettop(m_pthread) == 2
+                    && lua_touserdata(m_pthread, 1) == &LuaAsyncCall::key)
+                {
+                    m_pwaiting = static_cast<LuaAsyncCall*>(lua_touserdata(m_pthread, 2));
+                    lua_settop(m_pthread, 0);
+                    return false;
+                }
+                return true;
+            }
+
+            m_finished = true;
+            if (status != LUA_OK) { m_pstack->throw_resume_error(m_pthread, status); }
+            return true;
+        }
+
+        /**
+         * True if resuming the thread does not block on an async call.
+         */
+        bool is_ready() const
+        {
+            return !m_pwaiting || m_pwaiting->is_ready();
+        }
+
+        T take_results()
+        {
+            // Only the yielded or returned values are left on the stack of
+            // the thread, keep the first ones (and nil for missing ones).
+            lua_settop(m_pthread, LuaResultCount<T>::value);
+            if constexpr (!std::is_void<T>::value)
+            {
+                T result = LuaResultGetter<T>::get(m_pthread);
+                lua_settop(m_pthread, 0);
+                return result;
+            }
+        }
+    };
+}
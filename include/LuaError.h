@@ -1,5 +1,8 @@
 #pragma once
 #include <stdexcept>
+#include <string>
+#include <utility>
+#include <lua.hpp>
 
 
 namespace lpp
@@ -7,8 +10,12 @@ namespace lpp
     class LuaError : public std::runtime_error
     {
     public:
-        LuaError(const std::string& msg)
-            : std::runtime_error(msg) {}
+        LuaError(const std::string& msg,
+                 int status = LUA_ERRRUN,
+                 std::string traceback = "")
+            : std::runtime_error(msg)
+            , m_status(status)
+            , m_traceback(std::move(traceback)) {}
         LuaError(const LuaError&) = default;
         LuaError& operator=(const LuaError&) = default;
         LuaError(LuaError&&) noexcept = default;
@@ -16,5 +23,60 @@ namespace lpp
         virtual ~LuaError() {}
 
         virtual const char* what() const noexcept override;
+
+        /**
+         * Lua status code of the failed call (LUA_ERRRUN, LUA_ERRMEM, ...).
+         */
+        int status() const noexcept { return m_status; }
+
+        /**
+         * Traceback of the error, empty unless it was captured (see
+         * LuaStack::set_traceback_mode).
+         */
+        const std::string& traceback() const noexcept { return m_traceback; }
+
+    private:
+        int m_status;
+        std::string m_traceback;
+    };
+
+    /**
+     * Raised when Lua runs out of memory, e.g. when a memory limit is hit.
+     */
+    class LuaMemoryError : public LuaError
+    {
+    public:
+        LuaMemoryError(const std::string& msg)
+            : LuaError(msg, LUA_ERRMEM) {}
+    };
+
+    /**
+     * Limit of a call budget (see LuaStack::set_budget).
+     */
+    enum class LuaBudgetLimit
+    {
+        instructions,
+        deadline
+    };
+
+    /**
+     * Raised when a call goes over its instruction count or deadline.
+     */
+    class LuaBudgetError : public LuaError
+    {
+    public:
+        LuaBudgetError(const std::string& msg,
+                       LuaBudgetLimit limit,
+                       std::string traceback = "")
+            : LuaError(msg, LUA_ERRRUN, std::move(traceback))
+            , m_limit(limit) {}
+
+        /**
+         * The limit that was exceeded.
+         */
+        LuaBudgetLimit limit() const noexcept { return m_limit; }
+
+    private:
+        LuaBudgetLimit m_limit;
     };
 }
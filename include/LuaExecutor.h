@@ -0,0 +1,128 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <LuaState.h>
+
+
+namespace lpp
+{
+    /**
+     * Options for creating a LuaExecutor.
+     */
+    struct LuaExecutorOptions
+    {
+        size_t num_workers = std::thread::hardware_concurrency();
+        LuaStateOptions state_options;         // Used to create each state
+        std::vector<std::string> scripts;      // Ran once in each state
+        std::function<void(LuaState&)> init;   // Ran once in each state afterwards
+    };
+
+    /**
+     * Runs Lua function calls on a pool of worker threads, each owning its own
+     * LuaState initialized from the same scripts. Calls are distributed over
+     * the workers round-robin, idle workers steal queued calls from busy ones.
+     */
+    class LuaExecutor
+    {
+    public:
+        /**
+         * Creates and initializes a state per worker, then starts the workers.
+         */
+        explicit LuaExecutor(LuaExecutorOptions options);
+        LuaExecutor(const LuaExecutor&) = delete;
+        LuaExecutor& operator=(const LuaExecutor&) = delete;
+
+        /**
+         * Finishes all queued calls and stops the workers.
+         */
+        ~LuaExecutor();
+
+        /**
+         * Queues a call of the global Lua function 'func_name' with the given
+         * arguments. The returned future holds the result, or the LuaError
+         * raised by the call.
+         */
+        template <typename T, typename... Ts>
+        std::future<T> submit(std::string func_name, Ts... args)
+        {
+            static_assert(!is_lua_string_view<T>,
+                          "Results are popped of the stack, the view would dangle. "
+                          "Use std::string instead.");
+            auto ppromise = std::make_shared<std::promise<T>>();
+            auto result = ppromise->get_future();
+            push_task([ppromise, func_name, args...](Worker& worker) {
+                try
+                {
+                    LuaStack& stack = *worker.state.get_stack();
+                    push_function(worker, func_name);
+                    (stack.push(args), ...);
+                    constexpr int num_results = LuaResultCount<T>::value;
+                    stack.pcall(sizeof...(Ts), num_results, 0);
+                    if constexpr (std::is_void<T>::value)
+                    {
+                        ppromise->set_value();
+                    }
+                    else
+                    {
+                        T value = stack.get_results<T>();
+                        stack.pop(num_results);
+                        ppromise->set_value(std::move(value));
+                    }
+                }
+                catch (...)
+                {
+                    ppromise->set_exception(std::current_exception());
+                }
+            });
+            return result;
+        }
+
+        size_t num_workers() const;
+
+        /**
+         * Amount of calls that were stolen from another worker's queue.
+         */
+        uint64_t steals() const;
+
+    private:
+        struct Worker;
+        using Task = std::function<void(Worker&)>;
+
+        struct Worker
+        {
+            explicit Worker(const LuaStateOptions& options)
+                : state(options) {}
+
+            LuaState state;
+            std::unordered_map<std::string, int> functions;  // Name => registry ref
+            std::deque<Task> queue;
+            std::mutex mutex;
+            std::thread thread;
+        };
+
+        std::vector<std::unique_ptr<Worker>> m_workers;
+        std::atomic<size_t> m_next_worker;
+        std::atomic<uint64_t> m_steals;
+
+        std::mutex m_mutex;  // Protects the members below
+        std::condition_variable m_work_available;
+        size_t m_pending;
+        bool m_stopping;
+
+        // Helper functions:
+
+        static void push_function(Worker& worker, const std::string& func_name);
+        void push_task(Task&& task);
+        bool pop_task(size_t index, Task& task);
+        void run(size_t index);
+    };
+}
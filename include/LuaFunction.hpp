@@ -1,13 +1,41 @@
 #pragma once
 #include <assert.h>
 #include <lua.hpp>
+#include <memory>
 #include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <LuaCoroutine.hpp>
 #include <LuaStack.h>
 #include <LuaError.h>
 
+#if __has_include(<span>)
+#include <span>
+#endif
+
 
 namespace lpp
 {
+    /**
+     * How LuaFunction::call_batch handles calls raising an error.
+     */
+    enum class LuaBatchMode
+    {
+        stop_on_error,  // Throw the error, remaining calls are skipped
+        record_errors   // Record the error and continue with the next call
+    };
+
+    /**
+     * Error raised by the call at position 'index' of a batch.
+     */
+    struct LuaBatchError
+    {
+        size_t index;
+        std::string message;
+    };
+
     /**
      * Template class for calling a Lua function in C++ as if it were a normal
      * C++ function. Uses variadic templates to achieve type-safeness.
@@ -15,6 +43,10 @@ namespace lpp
     template <typename T, typename... Ts>
     class LuaFunction
     {
+        static_assert(!is_lua_string_view<T>,
+                      "Results are popped of the stack, the view would dangle. "
+                      "Use std::string instead.");
+
     public:
         LuaFunction(const std::shared_ptr<LuaStack>& stack,
                     std::string&& file,
@@ -22,41 +54,165 @@ namespace lpp
             : m_pstack(stack)
             , m_file(file)
             , m_func_name(func_name)
+            , m_ref(LUA_NOREF)
         {
             assert(m_pstack);
-            m_pstack->load_file(m_file);
-            m_pstack->pcall(0, 0, 0);  // Prime the file once to load globals
+            m_pstack->prime_file(m_file);  // Load globals (once per file)
+            rebind();
+        }
+        LuaFunction(const LuaFunction& other)
+            : m_pstack(other.m_pstack)
+            , m_file(other.m_file)
+            , m_func_name(other.m_func_name)
+            , m_ref(LUA_NOREF)
+        {
+            m_pstack->push_ref(other.m_ref);
+            m_ref = m_pstack->make_ref();
+        }
+        LuaFunction& operator=(const LuaFunction& other)
+        {
+            if (this != &other)
+            {
+                LuaFunction copy(other);
+                *this = std::move(copy);
+            }
+            return *this;
         }
-        LuaFunction(const LuaFunction&) = default;
-        LuaFunction& operator=(const LuaFunction&) = default;
         LuaFunction(LuaFunction&& other) noexcept
             : m_pstack(other.m_pstack)
             , m_file(std::move(other.m_file))
-            , m_func_name(std::move(other.m_func_name)) {}
+            , m_func_name(std::move(other.m_func_name))
+            , m_ref(other.m_ref)
+        {
+            other.m_ref = LUA_NOREF;
+        }
         LuaFunction& operator=(LuaFunction&& other) noexcept
         {
-            m_pstack = other.m_pstack;
-            m_file = std::move(other.m_file);
-            m_func_name = std::move(other.m_func_name);
+            if (this != &other)
+            {
+                m_pstack->release_ref(m_ref);
+                m_pstack = other.m_pstack;
+                m_file = std::move(other.m_file);
+                m_func_name = std::move(other.m_func_name);
+                m_ref = other.m_ref;
+                other.m_ref = LUA_NOREF;
+            }
             return *this;
         }
-        ~LuaFunction() {}
+        ~LuaFunction()
+        {
+            m_pstack->release_ref(m_ref);
+        }
 
         T operator()(const Ts&... args)
+        {
+            constexpr int num_results = LuaResultCount<T>::value;
+            LuaStack& stack = *m_pstack;
+            stack.push_ref(m_ref);                         // Push function on stack
+            push_on_stack(args...);                        // Push values on stack
+            stack.pcall(sizeof...(args), num_results, 0);  // Execute function
+            if constexpr (!std::is_void<T>::value)
+            {
+                T result = stack.get_results<T>();         // Get results (now on top of stack)
+                stack.pop(num_results);                    // Pop results of stack (cleanup)
+                return result;
+            }
+        }
+
+        /**
+         * Calls the function once for every tuple of arguments in
+         * [first, last) and writes each result to 'out'. The function is
+         * looked up and stack space is reserved once for the whole batch.
+         * Returns the errors raised when recording them (see LuaBatchMode),
+         * a default constructed result is written for those calls.
+         */
+        template <typename InputIt, typename OutputIt>
+        std::vector<LuaBatchError> call_batch(InputIt first, InputIt last,
+                                              OutputIt out,
+                                              LuaBatchMode mode = LuaBatchMode::stop_on_error)
+        {
+            constexpr int num_results = LuaResultCount<T>::value;
+            LuaStack& stack = *m_pstack;
+            std::vector<LuaBatchError> errors;
+            stack.reserve(sizeof...(Ts) + 2);
+            stack.push_ref(m_ref);  // Stays below the calls during the batch
+
+            try
+            {
+                for (size_t i = 0; first != last; ++first, ++out, ++i)
+                {
+                    stack.push_copy(-1);
+                    std::apply([this](const Ts&... args) { push_on_stack(args...); },
+                               *first);
+
+                    if (mode == LuaBatchMode::stop_on_error)
+                    {
+                        stack.pcall(sizeof...(Ts), num_results, 0);
+                    }
+                    else if (stack.try_pcall(sizeof...(Ts), num_results, 0) != LUA_OK)
+                    {
+                        errors.push_back({ i, stack.get<std::string>(-1) });
+                        stack.pop(1);
+                        *out = T();
+                        continue;
+                    }
+
+                    *out = stack.get_results<T>();
+                    stack.pop(num_results);
+                }
+            }
+            catch (...)
+            {
+                stack.pop(1);
+                throw;
+            }
+
+            stack.pop(1);
+            return errors;
+        }
+
+#ifdef __cpp_lib_span
+        /**
+         * Calls the function once for every tuple of arguments in 'args',
+         * the result of args[i] is stored in results[i]. 'results' needs
+         * room for at least as many values as there are calls.
+         */
+        template <typename R = T, typename = std::enable_if_t<!std::is_void<R>::value>>
+        std::vector<LuaBatchError> call_batch(std::span<const std::tuple<Ts...>> args,
+                                              std::span<std::type_identity_t<R>> results,
+                                              LuaBatchMode mode = LuaBatchMode::stop_on_error)
+        {
+            assert(results.size() >= args.size() && "Not enough room for the results!");
+            return call_batch(args.begin(), args.end(), results.begin(), mode);
+        }
+#endif
+
+        /**
+         * Creates a coroutine running this function, see LuaCoroutine.
+         */
+        LuaCoroutine<T, Ts...> make_coroutine() const
+        {
+            m_pstack->push_ref(m_ref);
+            return LuaCoroutine<T, Ts...>(m_pstack);
+        }
+
+        /**
+         * Looks up the global function again and caches it in the registry.
+         * Needed when a script redefines the function after it was imported.
+         */
+        void rebind()
         {
             LuaStack& stack = *m_pstack;
-            stack.get_global(m_func_name);       // Push function on stack
-            push_on_stack(args...);              // Push values on stack
-            stack.pcall(sizeof...(args), 1, 0);  // Execute function
-            T result = stack.get<T>(-1);         // Get result (now on top of stack)
-            stack.pop(1);                        // Pop return value of stack (cleanup)
-            return result;
+            stack.release_ref(m_ref);
+            stack.get_global(m_func_name);
+            m_ref = stack.make_ref();
         }
 
     private:
-        const std::shared_ptr<LuaStack> m_pstack;
+        std::shared_ptr<LuaStack> m_pstack;
         std::string m_file;
         std::string m_func_name;
+        int m_ref;  // Registry reference to the Lua function
 
         // Helper functions:
 
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+
+
+namespace lpp
+{
+    /**
+     * Bitmask of the Lua standard libraries to open in a Lua instance.
+     */
+    enum class LuaLibs : uint32_t
+    {
+        none      = 0,
+        base      = 1 << 0,
+        package   = 1 << 1,
+        coroutine = 1 << 2,
+        table     = 1 << 3,
+        io        = 1 << 4,
+        os        = 1 << 5,
+        string    = 1 << 6,
+        math      = 1 << 7,
+        utf8      = 1 << 8,
+        debug     = 1 << 9,
+        all       = (1 << 10) - 1
+    };
+
+    constexpr LuaLibs operator|(LuaLibs lhs, LuaLibs rhs)
+    {
+        return static_cast<LuaLibs>(static_cast<uint32_t>(lhs)
+                                    | static_cast<uint32_t>(rhs));
+    }
+
+    constexpr LuaLibs operator&(LuaLibs lhs, LuaLibs rhs)
+    {
+        return static_cast<LuaLibs>(static_cast<uint32_t>(lhs)
+                                    & static_cast<uint32_t>(rhs));
+    }
+
+    constexpr LuaLibs operator~(LuaLibs libs)
+    {
+        return static_cast<LuaLibs>(~static_cast<uint32_t>(libs)
+                                    & static_cast<uint32_t>(LuaLibs::all));
+    }
+
+    constexpr bool contains(LuaLibs libs, LuaLibs lib)
+    {
+        return (libs & lib) == lib;
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <LuaAllocator.h>
+
+
+namespace lpp
+{
+    /**
+     * Memory usage of a Lua instance.
+     */
+    struct LuaMemoryStats
+    {
+        size_t current_bytes = 0;        // Bytes currently in use
+        size_t peak_bytes = 0;           // Highest amount of bytes in use
+        uint64_t allocation_count = 0;   // Amount of new blocks allocated
+        uint64_t failed_allocations = 0; // Allocations refused or failed
+    };
+
+    /**
+     * Allocator that keeps track of the memory usage of a Lua instance and
+     * optionally enforces a hard limit on it. The actual allocations are
+     * forwarded to another allocator.
+     */
+    class LuaMemoryTracker : public LuaAllocator
+    {
+    public:
+        /**
+         * Tracks the allocations done by 'pallocator', or by a
+         * LuaDefaultAllocator when none is given.
+         */
+        explicit LuaMemoryTracker(std::shared_ptr<LuaAllocator> pallocator = nullptr);
+
+        void* reallocate(void* ptr,
+                         size_t old_size,
+                         size_t new_size) noexcept override;
+
+        /**
+         * Sets the maximum amount of bytes Lua is allowed to use,
+         * 0 means no limit. Allocations exceeding it fail, which Lua
+         * reports as a memory error.
+         */
+        void set_limit(size_t max_bytes);
+
+        size_t limit() const;
+        const LuaMemoryStats& stats() const;
+
+    private:
+        std::shared_ptr<LuaAllocator> m_pallocator;
+        size_t m_limit;
+        LuaMemoryStats m_stats;
+    };
+}
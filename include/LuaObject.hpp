@@ -0,0 +1,183 @@
+#pragma once
+#include <assert.h>
+#include <algorithm>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <lua.hpp>
+
+
+namespace lpp
+{
+    template <typename T>
+    T* to_lua_object(lua_State* plua, int location);
+
+    /**
+     * Metatable shared by all Lua objects of a C++ class. Created once per
+     * Lua instance and stored in the registry, using the address of 'key' as
+     * registry key, so it is never looked up by name.
+     *
+     * The methods, property getters and property setters of the class are
+     * kept in tables stored in the metatable itself (under the addresses of
+     * the other keys). As long as the class has no properties, __index is
+     * the methods table so a method lookup never leaves the Lua VM.
+     * The objects table maps the address of each object to its userdata
+     * (with weak values), so a pointer to an object can be pushed again.
+     */
+    template <typename T>
+    struct LuaClassMetatable
+    {
+        static inline const char key = 0;
+        static inline const char methods_key = 0;
+        static inline const char getters_key = 0;
+        static inline const char setters_key = 0;
+        static inline const char objects_key = 0;
+
+        static void push(lua_State* plua)
+        {
+            if (lua_rawgetp(plua, LUA_REGISTRYINDEX, &key) != LUA_TNIL) { return; }
+            lua_pop(plua, 1);
+
+            lua_createtable(plua, 0, 5);
+            lua_pushboolean(plua, 0);
+            lua_setfield(plua, -2, "__metatable");  // Hidden from scripts
+            lua_newtable(plua);
+            lua_createtable(plua, 0, 1);
+            lua_pushliteral(plua, "v");
+            lua_setfield(plua, -2, "__mode");
+            lua_setmetatable(plua, -2);
+            lua_rawsetp(plua, -2, &objects_key);
+            lua_newtable(plua);
+            lua_pushvalue(plua, -1);
+            lua_setfield(plua, -3, "__index");
+            lua_rawsetp(plua, -2, &methods_key);
+            lua_newtable(plua);
+            lua_rawsetp(plua, -2, &getters_key);
+            lua_newtable(plua);
+            lua_pushvalue(plua, -1);
+            lua_pushcclosure(plua, &new_index, 1);
+            lua_setfield(plua, -3, "__newindex");
+            lua_rawsetp(plua, -2, &setters_key);
+            lua_pushcfunction(plua, &gc);
+            lua_setfield(plua, -2, "__gc");
+            lua_pushvalue(plua, -1);
+            lua_rawsetp(plua, LUA_REGISTRYINDEX, &key);
+        }
+
+        /**
+         * __index used once the class has properties.
+         * Upvalues: methods table, getters table.
+         */
+        static int index(lua_State* plua)
+        {
+            lua_pushvalue(plua, 2);
+            if (lua_rawget(plua, lua_upvalueindex(1)) != LUA_TNIL) { return 1; }
+            lua_pushvalue(plua, 2);
+            if (lua_rawget(plua, lua_upvalueindex(2)) == LUA_TNIL) { return 1; }
+            lua_pushvalue(plua, 1);
+            lua_call(plua, 1, 1);
+            return 1;
+        }
+
+        /**
+         * Upvalues: setters table.
+         */
+        static int new_index(lua_State* plua)
+        {
+            lua_pushvalue(plua, 2);
+            if (lua_rawget(plua, lua_upvalueindex(1)) == LUA_TNIL)
+            {
+                return luaL_error(plua, "no writable property '%s'",
+                                  luaL_tolstring(plua, 2, nullptr));
+            }
+            lua_pushvalue(plua, 1);
+            lua_pushvalue(plua, 3);
+            lua_call(plua, 2, 0);
+            return 0;
+        }
+
+        static int gc(lua_State* plua)
+        {
+            auto pobject = to_lua_object<T>(plua, 1);
+            if (!pobject) { return 0; }  // Not an object (anymore)
+            pobject->~T();
+
+            // Detach the userdata, so it is not destroyed again and methods
+            // and properties reject it.
+            lua_getmetatable(plua, 1);
+            lua_rawgetp(plua, -1, &objects_key);
+            lua_pushnil(plua);
+            lua_rawsetp(plua, -2, pobject);
+            lua_pop(plua, 2);
+            lua_pushnil(plua);
+            lua_setmetatable(plua, 1);
+            return 0;
+        }
+    };
+
+
+    /**
+     * Constructs an object of class T inline in a new full userdata on top of
+     * the Lua stack. It is destroyed when Lua collects it.
+     */
+    template <typename T, typename... Args>
+    T* push_lua_object(lua_State* plua, Args&&... args)
+    {
+        static_assert(alignof(T) <= std::max(alignof(lua_Number), alignof(void*)),
+                      "Lua userdata is not aligned enough for this type!");
+        assert(plua);
+
+        // Everything that can raise a memory error is done before the
+        // object is constructed, so it always gets its __gc.
+        // NOTE: if the constructor throws, the userdata has no metatable
+        // and is collected without calling the destructor.
+        void* pmemory = lua_newuserdata(plua, sizeof(T));
+        LuaClassMetatable<T>::push(plua);
+        lua_rawgetp(plua, -1, &LuaClassMetatable<T>::objects_key);
+        lua_pushvalue(plua, -3);
+        lua_rawsetp(plua, -2, pmemory);
+        lua_pop(plua, 1);
+        T* pobject = new (pmemory) T(std::forward<Args>(args)...);
+        lua_setmetatable(plua, -2);
+        return pobject;
+    }
+
+    /**
+     * Pushes an object that lives in Lua (created by push_lua_object or in
+     * Lua itself) onto the Lua stack. Pushes nil for nullptr and for
+     * objects not owned by Lua.
+     */
+    template <typename T>
+    std::enable_if_t<std::is_class<T>::value> push_on_stack(lua_State* plua, T* pobject)
+    {
+        assert(plua);
+        if (!pobject)
+        {
+            lua_pushnil(plua);
+            return;
+        }
+
+        using Metatable = LuaClassMetatable<std::remove_cv_t<T>>;
+        Metatable::push(plua);
+        lua_rawgetp(plua, -1, &Metatable::objects_key);
+        lua_rawgetp(plua, -1, pobject);  // nil if not owned by Lua
+        lua_replace(plua, -3);
+        lua_pop(plua, 1);
+    }
+
+    /**
+     * Gets the object at a certain position of the Lua stack, or nullptr if
+     * the element is not an object of class T.
+     */
+    template <typename T>
+    T* to_lua_object(lua_State* plua, int location)
+    {
+        void* pmemory = lua_touserdata(plua, location);
+        if (!pmemory || !lua_getmetatable(plua, location)) { return nullptr; }
+
+        lua_rawgetp(plua, LUA_REGISTRYINDEX, &LuaClassMetatable<T>::key);
+        bool is_object = lua_rawequal(plua, -1, -2);
+        lua_pop(plua, 2);
+        return is_object ? static_cast<T*>(pmemory) : nullptr;
+    }
+}
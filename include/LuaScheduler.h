@@ -0,0 +1,305 @@
+#pragma once
+#include <chrono>
+#include <exception>
+#include <future>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <LuaCoroutine.hpp>
+
+
+namespace lpp
+{
+    /**
+     * Coroutine run by a LuaScheduler, independent of its types.
+     */
+    class LuaTask
+    {
+    public:
+        virtual ~LuaTask();
+
+        /**
+         * True if resuming the task does not block on an async call.
+         */
+        virtual bool is_ready() const = 0;
+
+        /**
+         * Waits at most 'timeout' until the task is ready.
+         */
+        virtual void wait_for(std::chrono::nanoseconds timeout) const = 0;
+
+        /**
+         * Resumes the task once, returns true once it finished.
+         */
+        virtual bool step() = 0;
+
+        /**
+         * Called once the task finished and was removed from its scheduler.
+         */
+        virtual void finish() {}
+    };
+
+    /**
+     * LuaCoroutine run by a LuaScheduler. The value it returns (or the error
+     * it raises) is reported through a std::future, the values it yields
+     * itself are dropped.
+     */
+    template <typename T, typename... Ts>
+    class LuaCoroutineTask final : public LuaTask
+    {
+    public:
+        LuaCoroutineTask(LuaCoroutine<T, Ts...>&& coroutine, const Ts&... args)
+            : m_coroutine(std::move(coroutine))
+            , m_args(args...) {}
+
+        std::future<T> get_future()
+        {
+            return m_promise.get_future();
+        }
+
+        bool is_ready() const override
+        {
+            return m_coroutine.is_ready();
+        }
+
+        void wait_for(std::chrono::nanoseconds timeout) const override
+        {
+            if (m_coroutine.m_pwaiting) { m_coroutine.m_pwaiting->wait_for(timeout); }
+        }
+
+        bool step() override
+        {
+            try
+            {
+                bool has_values = false;
+                if (m_started)
+                {
+                    has_values = m_coroutine.resume_thread(0);
+                }
+                else
+                {
+                    m_started = true;
+                    std::apply([this](const Ts&... args) { m_coroutine.push_args(args...); },
+                               m_args);
+                    has_values = m_coroutine.resume_thread(sizeof...(Ts));
+                }
+
+                if (!has_values) { return false; }
+                if (!m_coroutine.is_finished())
+                {
+                    lua_settop(m_coroutine.m_pthread, 0);  // Resumed on the next poll
+                    return false;
+                }
+
+                if constexpr (std::is_void<T>::value)
+                {
+                    m_coroutine.take_results();
+                    m_promise.set_value();
+                }
+                else
+                {
+                    m_promise.set_value(m_coroutine.take_results());
+                }
+            }
+            catch (...)
+            {
+                m_promise.set_exception(std::current_exception());
+            }
+            return true;
+        }
+
+    private:
+        LuaCoroutine<T, Ts...> m_coroutine;
+        std::tuple<Ts...> m_args;  // Arguments of the first resume
+        std::promise<T> m_promise;
+        bool m_started = false;
+    };
+
+
+#ifdef LPP_HAS_COROUTINES
+    /**
+     * Lua coroutine awaited by a C++ coroutine (see LuaScheduler::resume)
+     * that waits for an async call. The C++ coroutine is resumed once the
+     * Lua coroutine yields, returns or raises an error.
+     */
+    template <typename T, typename... Ts>
+    class LuaResumeTask final : public LuaTask
+    {
+    public:
+        LuaResumeTask(LuaCoroutine<T, Ts...>& coroutine,
+                      std::coroutine_handle<> awaiting,
+                      std::exception_ptr& error)
+            : m_coroutine(coroutine)
+            , m_awaiting(awaiting)
+            , m_error(error) {}
+
+        bool is_ready() const override
+        {
+            return m_coroutine.is_ready();
+        }
+
+        void wait_for(std::chrono::nanoseconds timeout) const override
+        {
+            if (m_coroutine.m_pwaiting) { m_coroutine.m_pwaiting->wait_for(timeout); }
+        }
+
+        bool step() override
+        {
+            try
+            {
+                return m_coroutine.resume_thread(0);
+            }
+            catch (...)
+            {
+                m_error = std::current_exception();
+            }
+            return true;
+        }
+
+        void finish() override
+        {
+            m_awaiting.resume();
+        }
+
+    private:
+        LuaCoroutine<T, Ts...>& m_coroutine;
+        std::coroutine_handle<> m_awaiting;
+        std::exception_ptr& m_error;  // Lives in the awaiting coroutine
+    };
+#endif
+
+
+    /**
+     * Runs many Lua coroutines on one thread. A coroutine waiting for an
+     * async C++ function (see LuaStack::export_async_function) is only
+     * resumed once the result is available, the other coroutines keep
+     * running in the meantime. A coroutine yielding in Lua is resumed on
+     * the next poll.
+     *
+     * Not thread-safe, coroutines of the same Lua instance should be run by
+     * the same scheduler.
+     */
+    class LuaScheduler
+    {
+    public:
+        LuaScheduler() = default;
+        LuaScheduler(const LuaScheduler& other) = delete;
+        LuaScheduler& operator=(const LuaScheduler& other) = delete;
+        LuaScheduler(LuaScheduler&& other) = default;
+        LuaScheduler& operator=(LuaScheduler&& other) = default;
+        ~LuaScheduler() = default;
+
+        /**
+         * Starts running a coroutine with the given arguments, until it
+         * yields or waits for an async call. The future gets the value it
+         * returns.
+         */
+        template <typename T, typename... Ts>
+        std::future<T> spawn(LuaCoroutine<T, Ts...>&& coroutine, const Ts&... args)
+        {
+            auto ptask = std::make_unique<LuaCoroutineTask<T, Ts...>>(std::move(coroutine),
+                                                                      args...);
+            auto result = ptask->get_future();
+            if (!ptask->step())
+            {
+                m_tasks.push_back(std::move(ptask));
+            }
+            return result;
+        }
+
+#ifdef LPP_HAS_COROUTINES
+        /**
+         * Awaitable for C++20 coroutines, 'co_await scheduler.resume(
+         * coroutine, args...)' results in the values the Lua coroutine
+         * yielded or returned, errors are raised in the awaiting coroutine.
+         * While the Lua coroutine waits for an async call, the awaiting
+         * coroutine is suspended and resumed by poll once the result is
+         * available.
+         */
+        template <typename T, typename... Ts>
+        LuaResumeAwaiter<T, Ts...> resume(LuaCoroutine<T, Ts...>& coroutine,
+                                          const std::type_identity_t<Ts>&... args)
+        {
+            return LuaResumeAwaiter<T, Ts...>(*this, coroutine, args...);
+        }
+#endif
+
+        /**
+         * Resumes every coroutine that is ready once. Returns the amount of
+         * coroutines resumed.
+         */
+        size_t poll();
+
+        /**
+         * Runs until every coroutine finished, waiting for async calls when
+         * no coroutine is ready.
+         */
+        void run();
+
+        /**
+         * Amount of coroutines that did not finish yet.
+         */
+        size_t size() const;
+
+    private:
+        std::vector<std::unique_ptr<LuaTask>> m_tasks;
+
+        template <typename T, typename... Ts>
+        friend class LuaResumeAwaiter;
+    };
+
+
+#ifdef LPP_HAS_COROUTINES
+    /**
+     * Awaitable returned by LuaScheduler::resume. The Lua coroutine is
+     * resumed right away, the awaiting coroutine is only suspended if it
+     * has to wait for an async call.
+     */
+    template <typename T, typename... Ts>
+    class LuaResumeAwaiter
+    {
+    public:
+        LuaResumeAwaiter(LuaScheduler& scheduler,
+                         LuaCoroutine<T, Ts...>& coroutine,
+                         const Ts&... args)
+            : m_scheduler(scheduler)
+            , m_coroutine(coroutine)
+            , m_args(args...) {}
+
+        bool await_ready()
+        {
+            try
+            {
+                std::apply([this](const Ts&... args) { m_coroutine.push_args(args...); },
+                           m_args);
+                return m_coroutine.resume_thread(sizeof...(Ts));
+            }
+            catch (...)
+            {
+                m_error = std::current_exception();
+            }
+            return true;
+        }
+
+        void await_suspend(std::coroutine_handle<> awaiting)
+        {
+            m_scheduler.m_tasks.push_back(
+                std::make_unique<LuaResumeTask<T, Ts...>>(m_coroutine, awaiting, m_error));
+        }
+
+        T await_resume()
+        {
+            if (m_error) { std::rethrow_exception(m_error); }
+            return m_coroutine.take_results();
+        }
+
+    private:
+        LuaScheduler& m_scheduler;
+        LuaCoroutine<T, Ts...>& m_coroutine;
+        std::tuple<Ts...> m_args;
+        std::exception_ptr m_error;
+    };
+#endif
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <vector>
+#include <LuaAllocator.h>
+
+
+namespace lpp
+{
+    /**
+     * Size-class slab allocator tuned for Lua.
+     * Most Lua objects (short strings, tables, closures, upvalues) are small,
+     * blocks up to MAX_SMALL_SIZE bytes are served from per size class free
+     * lists carved out of large slabs. Bigger blocks (table arrays, long
+     * strings) fall back to realloc. Slabs are only released when the
+     * allocator is destroyed. Not thread-safe, use one per LuaState.
+     */
+    class LuaSlabAllocator : public LuaAllocator
+    {
+    public:
+        static constexpr size_t GRANULARITY = 8;
+        static constexpr size_t MAX_SMALL_SIZE = 256;
+        static constexpr size_t DEFAULT_SLAB_SIZE = 64 * 1024;
+
+        explicit LuaSlabAllocator(size_t slab_size = DEFAULT_SLAB_SIZE);
+        ~LuaSlabAllocator() override;
+
+        void* reallocate(void* ptr,
+                         size_t old_size,
+                         size_t new_size) noexcept override;
+
+    private:
+        struct FreeBlock
+        {
+            FreeBlock* next;
+        };
+
+        static constexpr size_t NUM_SIZE_CLASSES = MAX_SMALL_SIZE / GRANULARITY;
+
+        size_t m_slab_size;
+        std::array<FreeBlock*, NUM_SIZE_CLASSES> m_free_lists;
+        // Slabs, and blocks from malloc kept as small block (see
+        // reallocate). There is always room for a slot per large block, so
+        // tracking a kept block never allocates.
+        std::vector<void*> m_slabs;
+        size_t m_large_blocks = 0;  // Blocks from malloc in use by Lua
+
+        // Helper functions:
+
+        static size_t size_class(size_t size);
+        void* allocate_small(size_t size_class) noexcept;
+        void free_small(void* ptr, size_t size_class) noexcept;
+        void* allocate_large(size_t size) noexcept;
+        void free_large(void* ptr) noexcept;
+        bool reserve_slots(size_t amount) noexcept;
+        bool add_slab(size_t size_class) noexcept;
+    };
+}
@@ -1,13 +1,55 @@
 #pragma once
 #include <assert.h>
+#include <chrono>
 #include <cstdint>
+#include <filesystem>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <lua.hpp>
+#include <LuaAllocator.h>
+#include <LuaAsync.hpp>
+#include <LuaBytecodeCache.h>
+#include <LuaClass.hpp>
+#include <LuaLibs.h>
 #include <LuaStackHelpers.hpp>
 
 
 namespace lpp
 {
+    /**
+     * When to capture a traceback for errors in protected calls:
+     * - none: only the message and status code are kept (cheapest).
+     * - always: for every error.
+     * - sampled: for 1 in every N errors.
+     */
+    enum class LuaTraceback
+    {
+        none,
+        always,
+        sampled
+    };
+
+
+    /**
+     * Limits for each protected call (see LuaStack::set_budget), 0 means
+     * no limit. The hook checking them runs every 'check_every' VM
+     * instructions, a smaller value aborts closer to the limit but costs
+     * more.
+     */
+    struct LuaBudget
+    {
+        uint64_t max_instructions = 0;          // VM instructions per call
+        std::chrono::nanoseconds timeout{ 0 };  // Wall-clock time per call
+        uint32_t check_every = 1000;            // Instructions between checks
+
+        bool is_limited() const
+        {
+            return max_instructions != 0 || timeout.count() != 0;
+        }
+    };
+
+
     /**
      * C++ wrapper around the Lua virtual stack.
      * Provides both high- and low-level operations.
@@ -15,7 +57,14 @@ namespace lpp
     class LuaStack
     {
     public:
-        LuaStack(lua_State* const pLua);
+        /**
+         * Takes ownership of a Lua instance and opens the requested standard
+         * libraries. The allocator (if any) the instance was created with is
+         * kept alive until the instance is closed.
+         */
+        LuaStack(lua_State* const pLua,
+                 std::shared_ptr<LuaAllocator> pallocator = nullptr,
+                 LuaLibs libs = LuaLibs::all);
         LuaStack(const LuaStack& other) = delete;
         LuaStack& operator=(const LuaStack& other) = delete;
         LuaStack(LuaStack&& other) = default;
@@ -34,19 +83,93 @@ namespace lpp
          */
         void run_file(const std::string& script_path) const;
 
+        /**
+         * Loads a Lua script from a file and runs it once to define its
+         * globals. Files that were already primed and did not change on disk
+         * since then (keyed by canonical path and modification time) are
+         * skipped, so importing many functions from one file runs it once.
+         */
+        void prime_file(const std::string& script_path) const;
+
         /**
          * Runs a Lua script from a string in memory.
          */
         void run_string(const std::string& script_code) const;
 
+        /**
+         * Opens (a subset of) the Lua standard libraries.
+         */
+        void open_libs(LuaLibs libs) const;
+
+        /**
+         * Opens the base and string libraries right away, the other
+         * libraries are opened the first time their global is accessed.
+         * (The string library is needed for string methods, which are not
+         * looked up through the globals table.)
+         */
+        void open_libs_lazily(LuaLibs libs) const;
+
+        /**
+         * Enables loading scripts through an on-disk bytecode cache.
+         * Passing nullptr disables the cache again.
+         */
+        void set_bytecode_cache(std::shared_ptr<const LuaBytecodeCache> pcache);
+
+        /**
+         * Sets when tracebacks are captured for errors in protected calls
+         * without an explicit error handler. The traceback is available
+         * through LuaError::traceback(). For sampled mode, 'sample_every'
+         * is the N in "1 in N errors".
+         */
+        void set_traceback_mode(LuaTraceback mode, uint32_t sample_every = 1);
+
+        /**
+         * Sets the budget for every following protected call (pcall,
+         * run_string, run_file, LuaFunction calls). A call going over it is
+         * aborted with a LuaBudgetError, even if the script catches the
+         * error itself. Nested calls share the budget of the outermost one.
+         * Each resume of a coroutine (see resume) counts as a call of its
+         * own. Without limits (the default), no hook is installed at all.
+         */
+        void set_budget(const LuaBudget& budget);
+
+        /**
+         * Resumes the Lua thread 'pthread' (see lua_resume) with the top
+         * 'param_amount' values on its stack, within the budget. Returns
+         * the status of lua_resume.
+         */
+        int resume(lua_State* pthread, int param_amount) const;
+
+        /**
+         * Throws the error of a failed resume of 'pthread' as an exception
+         * matching the Lua status code, and clears the stack of the thread.
+         */
+        [[noreturn]] void throw_resume_error(lua_State* pthread, int status) const;
+
         /**
          * Do a protected call of a function with X amount of params and Y
          * return values and err handler on location 'err_handler_loc'.
+         * If 'err_handler_loc' is 0, the built-in message handler is used
+         * (depending on the traceback mode).
          */
         void pcall(uint32_t param_amount,
                    uint32_t return_amount,
                    int32_t err_handler_loc) const;
 
+        /**
+         * Same as pcall, but returns the Lua status code instead of throwing.
+         * On failure the error message is left on top of the stack.
+         */
+        int try_pcall(uint32_t param_amount,
+                      uint32_t return_amount,
+                      int32_t err_handler_loc) const;
+
+        /**
+         * Performs an incremental garbage collection step of roughly
+         * 'step_kb' kilobytes. Returns true if a collection cycle finished.
+         */
+        bool gc_step(int step_kb) const;
+
         // Low level operations:
 
         /**
@@ -62,12 +185,57 @@ namespace lpp
             return LuaStackGetter(m_plua, location);
         }
 
+        /**
+         * Gets the result(s) of a function call, which are on top of the
+         * stack. Tuples and pairs take one element of the stack per member.
+         */
+        template <typename T>
+        T get_results() const
+        {
+            return LuaResultGetter<T>::get(m_plua);
+        }
+
+        /**
+         * Gets an integer of the stack at a certain position, raises a
+         * LuaError if it is not an integral number or does not fit in T.
+         */
+        template <typename T>
+        T get_checked(const int& location) const
+        {
+            return get_integer_checked<T>(m_plua, location);
+        }
+
         template <typename T>
         void push(const T& value) const
         {
             push_on_stack(m_plua, value);
         }
 
+        /**
+         * Constructs an object of a registered class on top of the stack.
+         */
+        template <typename T, typename... Args>
+        T* push_object(Args&&... args) const
+        {
+            return push_lua_object<T>(m_plua, std::forward<Args>(args)...);
+        }
+
+        /**
+         * Pushes a copy of the element at a certain position on the stack.
+         */
+        void push_copy(int location) const;
+
+        /**
+         * True if the element at a certain position is nil (or the position
+         * is not valid).
+         */
+        bool is_nil(int location) const;
+
+        /**
+         * Makes sure there is room for X more elements on the stack.
+         */
+        void reserve(uint32_t amount) const;
+
         /**
          * Pops X amount of elements of the stack.
          */
@@ -79,17 +247,157 @@ namespace lpp
         void get_global(const std::string& global) const;
 
         /**
-         * Exports a function from C++ to Lua.
+         * Pops the element on top of the stack and stores it in a global.
+         */
+        void set_global(const std::string& global) const;
+
+        /**
+         * Pops the element on top of the stack and stores it in the Lua
+         * registry. Returns a reference that can be used to push it again.
+         */
+        int make_ref() const;
+
+        /**
+         * Pushes an element stored in the Lua registry on top of the stack.
+         */
+        void push_ref(int ref) const;
+
+        /**
+         * Releases an element stored in the Lua registry.
+         */
+        void release_ref(int ref) const;
+
+        /**
+         * Pops the function on top of the stack and pushes a new Lua thread
+         * (coroutine) that will run it. Returns the thread, which is only
+         * kept alive as long as it is referenced in Lua (e.g. by make_ref).
          */
-        template <typename ReturnType, typename... ParameterTypes>
+        lua_State* new_thread() const;
+
+        /**
+         * Exports a function from C++ to Lua. The policy decides how its
+         * arguments are checked, e.g.:
+         * export_function<LuaArgPolicy::strict>(add, "add").
+         */
+        template <LuaArgPolicy Policy = LuaArgPolicy::lenient,
+                  typename ReturnType, typename... ParameterTypes>
         void export_function(ExportableFunction<ReturnType, ParameterTypes...> f,
                              std::string&& lua_function_name) const
         {
-            export_function_helper(m_plua, f,
+            export_function_helper<Policy>(m_plua, f,
                                    std::forward<std::string>(lua_function_name));
         }
 
+        /**
+         * Exports a function known at compile time from C++ to Lua, e.g.
+         * export_function<&add>("add"). Calls are direct, so small functions
+         * can be inlined.
+         */
+        template <auto F, LuaArgPolicy Policy = LuaArgPolicy::lenient>
+        void export_function(std::string&& lua_function_name) const
+        {
+            export_static_function_helper<F, Policy>(
+                m_plua, std::forward<std::string>(lua_function_name),
+                typename LuaFunctionTraits<decltype(F)>::Signature{});
+        }
+
+        /**
+         * Exports a lambda, functor or std::function from C++ to Lua. The
+         * callable is moved into Lua and destroyed along with the exported
+         * function. (Lambdas without captures are exported as plain
+         * functions.)
+         */
+        template <LuaArgPolicy Policy = LuaArgPolicy::lenient, typename Callable,
+                  typename = std::enable_if_t<is_lua_callable<Callable>>>
+        void export_function(Callable&& f, std::string&& lua_function_name) const
+        {
+            export_callable_helper<Policy>(m_plua, std::forward<Callable>(f),
+                                   std::forward<std::string>(lua_function_name),
+                                   typename LuaCallableTraits<std::decay_t<Callable>>::Signature{});
+        }
+
+        /**
+         * Exports a C++ function doing asynchronous work (e.g. I/O) to Lua.
+         * The function (pointer, lambda or functor) returns a std::future
+         * with its result. Called from a LuaCoroutine, it suspends the
+         * coroutine until the result is available (see LuaScheduler),
+         * elsewhere (including coroutines created in Lua) it waits for the
+         * result.
+         */
+        template <LuaArgPolicy Policy = LuaArgPolicy::lenient, typename Callable>
+        void export_async_function(Callable&& f, std::string&& lua_function_name) const
+        {
+            export_async_helper<Policy>(m_plua, std::forward<Callable>(f),
+                                std::forward<std::string>(lua_function_name),
+                                LuaSignatureOf<Callable>{});
+        }
+
+        /**
+         * Exports a C++ class to Lua, returns a builder for registering its
+         * constructor, methods and properties.
+         */
+        template <typename T>
+        LuaClass<T> register_class(std::string&& lua_class_name) const
+        {
+            return LuaClass<T>(m_plua, std::forward<std::string>(lua_class_name));
+        }
+
     private:
+        std::shared_ptr<LuaAllocator> m_pallocator;
         lua_State* const m_plua;
+        std::shared_ptr<const LuaBytecodeCache> m_pbytecode_cache;
+
+        // Canonical path => modification time of each primed file
+        mutable std::unordered_map<std::string,
+                                   std::filesystem::file_time_type> m_primed_files;
+
+        LuaTraceback m_traceback_mode = LuaTraceback::none;
+        uint32_t m_traceback_sample_every = 1;
+        mutable uint64_t m_error_count = 0;
+        // Traceback captured by the message handler for the last error
+        mutable std::string m_traceback;
+
+        LuaBudget m_budget;
+        // State of the budget of the running call:
+        mutable bool m_budget_running = false;
+        mutable uint64_t m_instructions_left = 0;
+        mutable std::chrono::steady_clock::time_point m_deadline;
+        mutable bool m_budget_exceeded = false;
+        mutable LuaBudgetLimit m_exceeded_limit = LuaBudgetLimit::instructions;
+
+        // Helper functions:
+
+        /**
+         * Pops the error message of a failed Lua call and throws it as an
+         * exception matching the Lua status code.
+         */
+        [[noreturn]] void throw_error(int status) const;
+
+        /**
+         * lua_pcall within the budget, with the built-in message handler
+         * inserted below the function if needed.
+         */
+        int protected_call(int param_amount, int return_amount, int err_handler) const;
+
+        int traced_call(int param_amount, int return_amount, int err_handler) const;
+
+        /**
+         * Starts the budget of an outermost call, and installs the hook
+         * enforcing it on the Lua thread 'plua'.
+         */
+        void start_budget() const;
+        void install_budget_hook(lua_State* plua) const;
+
+        /**
+         * Count hook enforcing the budget, finds the LuaStack in the extra
+         * space of the Lua thread.
+         */
+        static void budget_hook(lua_State* plua, lua_Debug* pdebug);
+
+        /**
+         * Message handler capturing tracebacks. Leaves the error message
+         * itself untouched.
+         */
+        static int message_handler(lua_State* plua);
     };
 }
@@ -1,51 +1,115 @@
 #pragma once
 #include <lua.hpp>
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <new>
+#include <map>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <LuaBuffer.hpp>
 #include <LuaError.h>
+#include <LuaObject.hpp>
+#include <LuaStruct.hpp>
 
 
 namespace lpp
 {
     template <typename ReturnType, typename... ParameterTypes>
     using ExportableFunction = ReturnType (*)(ParameterTypes...);
-    // TODO using Lambda typedef?
 
 
     /**
-     * Helper class for getting an element of the Lua stack.
+     * True for the integral types that are passed to Lua as integers.
      */
-    class LuaStackGetter
+    template <typename T>
+    constexpr bool is_lua_integer = std::is_integral<T>::value
+                                 && !std::is_same<T, bool>::value;
+
+
+    /**
+     * True for types pointing into a Lua string instead of holding a copy.
+     * These are only valid as long as the string remains on the stack, so
+     * they can be used as parameters of exported functions, but not as
+     * results of calls into Lua.
+     */
+    template <typename T>
+    constexpr bool is_lua_string_view = std::is_same<T, std::string_view>::value
+                                     || std::is_same<T, const char*>::value;
+
+
+    /**
+     * Gets an integer of the Lua stack, checking that it is a number with an
+     * integral value that fits in T. Raises a LuaError otherwise.
+     * (Negative values never fit in unsigned types, even though get wraps
+     * 64-bit unsigned values above INT64_MAX around to negative Lua
+     * integers and back.)
+     */
+    template <typename T>
+    T get_integer_checked(lua_State* plua, int location)
     {
-    public:
-        LuaStackGetter(lua_State* plua, const int& location)
-            : m_plua(plua)
-            , m_location(location)
+        static_assert(is_lua_integer<T>, "Expected an integral type!");
+
+        int is_integer = 0;
+        lua_Integer value = lua_tointegerx(plua, location, &is_integer);
+        if (!is_integer)
         {
-            assert(plua);
+            if (lua_type(plua, location) != LUA_TNUMBER)
+            {
+                throw LuaError(std::string("number expected, got ")
+                               + luaL_typename(plua, location));
+            }
+            throw LuaError("number has no integer representation");
         }
 
-        operator uint8_t() const
+        using Limits = std::numeric_limits<T>;
+        bool fits;
+        if constexpr (std::is_unsigned<T>::value && sizeof(T) >= sizeof(lua_Integer))
         {
-            return static_cast<uint8_t>(lua_tonumber(m_plua, m_location));
+            fits = value >= 0;
         }
-        operator uint16_t() const
+        else if constexpr (std::is_unsigned<T>::value)
         {
-            return static_cast<uint16_t>(lua_tonumber(m_plua, m_location));
+            fits = value >= 0 && static_cast<lua_Unsigned>(value) <= Limits::max();
         }
-        operator uint32_t() const
+        else
         {
-            return static_cast<uint32_t>(lua_tonumber(m_plua, m_location));
+            fits = value >= Limits::min() && value <= Limits::max();
         }
-        operator int8_t() const
+        if (!fits)
         {
-            return static_cast<int8_t>(lua_tonumber(m_plua, m_location));
+            throw LuaError("integer overflow: " + std::to_string(value)
+                           + " does not fit in the requested type");
         }
-        operator int16_t() const
+        return static_cast<T>(value);
+    }
+
+
+    /**
+     * Helper class for getting an element of the Lua stack.
+     */
+    class LuaStackGetter
+    {
+    public:
+        LuaStackGetter(lua_State* plua, int location)
+            : m_plua(plua)
+            , m_location(location)
         {
-            return static_cast<int16_t>(lua_tonumber(m_plua, m_location));
+            assert(plua);
         }
-        operator int32_t() const
+
+        template <typename T, typename = std::enable_if_t<is_lua_integer<T>>>
+        operator T() const
         {
-            return static_cast<int32_t>(lua_tonumber(m_plua, m_location));
+            int is_integer = 0;
+            lua_Integer value = lua_tointegerx(m_plua, m_location, &is_integer);
+            if (is_integer) { return static_cast<T>(value); }
+            return static_cast<T>(lua_tonumber(m_plua, m_location));  // Truncates
         }
         operator float() const
         {
@@ -60,219 +124,1021 @@ namespace lpp
             return lua_toboolean(m_plua, m_location);
         }
         operator std::string() const
+        {
+            size_t length = 0;
+            const char* str = lua_tolstring(m_plua, m_location, &length);
+            if (!str) { return ""; }
+            return std::string(str, length);
+        }
+        // NOTE: string views point into Lua memory, they are only valid as
+        // long as the string remains on the stack.
+        operator std::string_view() const
+        {
+            size_t length = 0;
+            const char* str = lua_tolstring(m_plua, m_location, &length);
+            if (!str) { return std::string_view(); }
+            return std::string_view(str, length);
+        }
+        operator const char*() const
         {
             const char* str = lua_tostring(m_plua, m_location);
             if (!str) { return ""; }
             return str;
         }
+        template <typename T>
+        operator std::vector<T>() const
+        {
+            std::vector<T> values;
+            if (!lua_istable(m_plua, m_location)) { return values; }
+            values.reserve(lua_rawlen(m_plua, m_location));
+            get_sequence<T>(values.capacity(), [&values](T&& value) {
+                values.push_back(std::move(value));
+            });
+            return values;
+        }
+        template <typename T, size_t N>
+        operator std::array<T, N>() const
+        {
+            std::array<T, N> values{};
+            if (!lua_istable(m_plua, m_location)) { return values; }
+            size_t i = 0;
+            get_sequence<T>(N, [&values, &i](T&& value) { values[i++] = std::move(value); });
+            return values;
+        }
+        template <typename K, typename V>
+        operator std::map<K, V>() const
+        {
+            std::map<K, V> values;
+            get_map<K, V>([&values](K&& key, V&& value) {
+                values.emplace(std::move(key), std::move(value));
+            });
+            return values;
+        }
+        template <typename K, typename V>
+        operator std::unordered_map<K, V>() const
+        {
+            std::unordered_map<K, V> values;
+            get_map<K, V>([&values](K&& key, V&& value) {
+                values.emplace(std::move(key), std::move(value));
+            });
+            return values;
+        }
+        template <typename T, std::enable_if_t<is_lua_struct<T>, int> = 0>
+        operator T() const
+        {
+            T value{};
+            if (!lua_istable(m_plua, m_location)) { return value; }
+            get_struct(value, std::make_index_sequence<lua_field_count<T>>());
+            return value;
+        }
+        template <typename T>
+        operator LuaBuffer<T>() const
+        {
+            // Shares ownership with Lua for owned buffers, so the elements
+            // stay valid after the value is popped of the stack.
+            auto pbuffer = to_lua_buffer<T>(m_plua, m_location);
+            if (!pbuffer) { return LuaBuffer<T>(); }
+            return *pbuffer;
+        }
+#ifdef __cpp_lib_span
+        // Elements of a buffer, empty for any other value.
+        // NOTE: owned buffers are owned by Lua, the span is only valid as
+        // long as the buffer is reachable from Lua.
+        template <typename T>
+        operator std::span<T>() const
+        {
+            auto pbuffer = to_lua_buffer<std::remove_const_t<T>>(m_plua, m_location);
+            if (!pbuffer) { return {}; }
+            return pbuffer->span();
+        }
+#endif
+        // Objects of registered classes, nullptr for any other value.
+        // NOTE: the object is owned by Lua, it is only valid as long as it is
+        // reachable from Lua.
+        template <typename T, typename = std::enable_if_t<std::is_class<T>::value>>
+        operator T*() const
+        {
+            return to_lua_object<T>(m_plua, m_location);
+        }
 
     private:
         lua_State* m_plua;
-        const int& m_location;
+        int m_location;
+
+        // Helper functions:
+
+        template <typename T, typename F>
+        void get_sequence(size_t max_size, F&& add) const
+        {
+            luaL_checkstack(m_plua, 2, "too many nested containers");
+            const int table = lua_absindex(m_plua, m_location);
+            const size_t size = std::min(lua_rawlen(m_plua, table), max_size);
+            for (size_t i = 1; i <= size; ++i)
+            {
+                lua_rawgeti(m_plua, table, static_cast<lua_Integer>(i));
+                T value = LuaStackGetter(m_plua, -1);
+                lua_pop(m_plua, 1);
+                add(std::move(value));
+            }
+        }
+
+        template <typename T, size_t... Is>
+        void get_struct(T& value, std::index_sequence<Is...>) const
+        {
+            luaL_checkstack(m_plua, 3, "too many nested structs");
+            const int table = lua_absindex(m_plua, m_location);
+            LuaStructNames<T>::push(m_plua);
+            (get_field(value, table, Is + 1, std::get<Is>(LuaStruct<T>::fields)), ...);
+            lua_pop(m_plua, 1);
+        }
+
+        template <typename T, typename Field>
+        void get_field(T& value, int table, size_t name_index, const Field& field) const
+        {
+            lua_rawgeti(m_plua, -1, static_cast<lua_Integer>(name_index));
+            lua_rawget(m_plua, table);
+            if (!lua_isnil(m_plua, -1))
+            {
+                typename Field::MemberType member = LuaStackGetter(m_plua, -1);
+                value.*(field.member) = std::move(member);
+            }
+            lua_pop(m_plua, 1);
+        }
+
+        template <typename K, typename V, typename F>
+        void get_map(F&& add) const
+        {
+            if (!lua_istable(m_plua, m_location)) { return; }
+
+            luaL_checkstack(m_plua, 4, "too many nested containers");
+            const int table = lua_absindex(m_plua, m_location);
+            lua_pushnil(m_plua);
+            while (lua_next(m_plua, table))
+            {
+                // Convert a copy of the key, converting it in place (e.g. a
+                // number to a string) would confuse lua_next.
+                lua_pushvalue(m_plua, -2);
+                K key = LuaStackGetter(m_plua, -1);
+                V value = LuaStackGetter(m_plua, -2);
+                lua_pop(m_plua, 2);
+                add(std::move(key), std::move(value));
+            }
+        }
     };
 
 
+    /**
+     * Gets an element of the Lua stack, converted to T.
+     */
+    template <typename T>
+    T get_value(lua_State* plua, int location)
+    {
+        return LuaStackGetter(plua, location);
+    }
+
+
     /**
      * Helper function for pushing an element onto the Lua stack.
      */
-    inline void push_on_stack(lua_State* plua, const uint8_t& value)
+    template <typename T>
+    std::enable_if_t<is_lua_integer<T>> push_on_stack(lua_State* plua, const T& value)
     {
         assert(plua);
-        lua_pushnumber(plua, value);
+        lua_pushinteger(plua, static_cast<lua_Integer>(value));
     }
-    inline void push_on_stack(lua_State* plua, const uint16_t& value)
+    inline void push_on_stack(lua_State* plua, const float& value)
     {
         assert(plua);
-        lua_pushnumber(plua, value);
+        lua_pushnumber(plua, static_cast<double>(value));
     }
-    inline void push_on_stack(lua_State* plua, const uint32_t& value)
+    inline void push_on_stack(lua_State* plua, const double& value)
     {
         assert(plua);
         lua_pushnumber(plua, value);
     }
-    inline void push_on_stack(lua_State* plua, const int8_t& value)
+    inline void push_on_stack(lua_State* plua, const bool& value)
     {
         assert(plua);
-        lua_pushnumber(plua, value);
+        lua_pushboolean(plua, value);
     }
-    inline void push_on_stack(lua_State* plua, const int16_t& value)
+    inline void push_on_stack(lua_State* plua, const std::string& value)
     {
         assert(plua);
-        lua_pushnumber(plua, value);
+        lua_pushlstring(plua, value.c_str(), value.length());
     }
-    inline void push_on_stack(lua_State* plua, const int32_t& value)
+    inline void push_on_stack(lua_State* plua, const std::string_view& value)
     {
         assert(plua);
-        lua_pushnumber(plua, value);
+        lua_pushlstring(plua, value.data(), value.length());
     }
-    inline void push_on_stack(lua_State* plua, const float& value)
+    inline void push_on_stack(lua_State* plua, const char* value)
     {
         assert(plua);
-        lua_pushnumber(plua, static_cast<const double>(value));
+        lua_pushstring(plua, value);  // Pushes nil for nullptr
     }
-    inline void push_on_stack(lua_State* plua, const double& value)
+
+    // Containers are pushed as tables, presized to their exact amount of
+    // elements and filled with raw sets. (Declared up front so containers
+    // can be nested.)
+    template <typename T>
+    void push_on_stack(lua_State* plua, const std::vector<T>& values);
+    template <typename T, size_t N>
+    void push_on_stack(lua_State* plua, const std::array<T, N>& values);
+    template <typename K, typename V>
+    void push_on_stack(lua_State* plua, const std::map<K, V>& values);
+    template <typename K, typename V>
+    void push_on_stack(lua_State* plua, const std::unordered_map<K, V>& values);
+
+    // Structs with a LuaStruct specialization are pushed as tables keyed by
+    // their (interned) field names.
+    template <typename T>
+    std::enable_if_t<is_lua_struct<T>> push_on_stack(lua_State* plua, const T& value);
+
+    template <typename Sequence>
+    void push_sequence(lua_State* plua, const Sequence& values)
     {
         assert(plua);
-        lua_pushnumber(plua, value);
+        luaL_checkstack(plua, 2, "too many nested containers");
+        lua_createtable(plua, static_cast<int>(values.size()), 0);
+        lua_Integer i = 1;
+        for (const auto& value : values)
+        {
+            push_on_stack(plua, value);
+            lua_rawseti(plua, -2, i++);
+        }
     }
-    inline void push_on_stack(lua_State* plua, const bool& value)
+
+    template <typename Map>
+    void push_map(lua_State* plua, const Map& values)
     {
         assert(plua);
-        lua_pushboolean(plua, value);
+        luaL_checkstack(plua, 3, "too many nested containers");
+        lua_createtable(plua, 0, static_cast<int>(values.size()));
+        for (const auto& [key, value] : values)
+        {
+            push_on_stack(plua, key);
+            push_on_stack(plua, value);
+            lua_rawset(plua, -3);
+        }
     }
-    inline void push_on_stack(lua_State* plua, const std::string& value)
+
+    template <typename T>
+    void push_on_stack(lua_State* plua, const std::vector<T>& values)
     {
-        assert(plua);
-        lua_pushlstring(plua, value.c_str(), value.length());
+        push_sequence(plua, values);
+    }
+    template <typename T, size_t N>
+    void push_on_stack(lua_State* plua, const std::array<T, N>& values)
+    {
+        push_sequence(plua, values);
+    }
+    template <typename K, typename V>
+    void push_on_stack(lua_State* plua, const std::map<K, V>& values)
+    {
+        push_map(plua, values);
+    }
+    template <typename K, typename V>
+    void push_on_stack(lua_State* plua, const std::unordered_map<K, V>& values)
+    {
+        push_map(plua, values);
     }
 
+    template <typename T, size_t... Is>
+    void push_struct(lua_State* plua, const T& value, std::index_sequence<Is...>)
+    {
+        // Stack: names, table
+        ((lua_rawgeti(plua, -2, static_cast<lua_Integer>(Is + 1)),
+          push_on_stack(plua, value.*(std::get<Is>(LuaStruct<T>::fields).member)),
+          lua_rawset(plua, -3)), ...);
+    }
 
-    template <typename ParamType, typename... AccumParamTypes>
-    auto do_fetch_param(lua_State* plua_state, int index_of_param,
-                        std::tuple<AccumParamTypes...>&& params)
+    template <typename T>
+    std::enable_if_t<is_lua_struct<T>> push_on_stack(lua_State* plua, const T& value)
     {
-        ParamType value = LuaStackGetter(plua_state, index_of_param + 1);
-        return std::tuple_cat(std::forward<std::tuple<AccumParamTypes...>>(params),
-                              std::make_tuple(std::forward<ParamType>(value)));
+        assert(plua);
+        luaL_checkstack(plua, 4, "too many nested structs");
+        LuaStructNames<T>::push(plua);
+        lua_createtable(plua, 0, static_cast<int>(lua_field_count<T>));
+        push_struct(plua, value, std::make_index_sequence<lua_field_count<T>>());
+        lua_remove(plua, -2);
     }
 
-    template <typename...>
-    struct do_fetch_params {};
+
+    /**
+     * Amount of Lua values a C++ type corresponds to when used as the result
+     * of a function: none for void, one per element for tuples and pairs and
+     * one for all other types.
+     */
+    template <typename T>
+    struct LuaResultCount : std::integral_constant<int, 1> {};
 
     template <>
-    struct do_fetch_params<std::tuple<>, std::tuple<>>
+    struct LuaResultCount<void> : std::integral_constant<int, 0> {};
+
+    template <typename... Ts>
+    struct LuaResultCount<std::tuple<Ts...>>
+        : std::integral_constant<int, sizeof...(Ts)> {};
+
+    template <typename T1, typename T2>
+    struct LuaResultCount<std::pair<T1, T2>> : std::integral_constant<int, 2> {};
+
+
+    /**
+     * Helper function for pushing the result of a function onto the Lua
+     * stack. Returns the amount of values pushed.
+     */
+    template <typename T>
+    int push_results(lua_State* plua, const T& value)
+    {
+        push_on_stack(plua, value);
+        return 1;
+    }
+    template <typename... Ts>
+    int push_results(lua_State* plua, const std::tuple<Ts...>& values)
     {
-        void operator()(lua_State*, int, std::tuple<>&&) {}
+        std::apply([plua](const Ts&... value) { (push_on_stack(plua, value), ...); },
+                   values);
+        return sizeof...(Ts);
+    }
+    template <typename T1, typename T2>
+    int push_results(lua_State* plua, const std::pair<T1, T2>& values)
+    {
+        push_on_stack(plua, values.first);
+        push_on_stack(plua, values.second);
+        return 2;
+    }
+
+
+    /**
+     * Helper class for getting the result(s) of a function call of the top
+     * of the Lua stack.
+     */
+    template <typename T>
+    struct LuaResultGetter
+    {
+        static T get(lua_State* plua)
+        {
+            return LuaStackGetter(plua, -1);
+        }
     };
 
-    template <typename LastParamType,
-              typename... AccumParamTypes>
-    struct do_fetch_params<std::tuple<LastParamType>,
-                           std::tuple<AccumParamTypes...>>
+    template <typename... Ts>
+    struct LuaResultGetter<std::tuple<Ts...>>
     {
-        auto operator()(lua_State* plua_state, int i,
-                        std::tuple<AccumParamTypes...>&& params)
+        static std::tuple<Ts...> get(lua_State* plua)
         {
-            using ParamTypes = std::tuple<AccumParamTypes...>;
-            return do_fetch_param<LastParamType>(plua_state, i,
-                                                 std::forward<ParamTypes>(params));
+            return get(plua, std::index_sequence_for<Ts...>{});
         }
+
+    private:
+        template <size_t... Is>
+        static std::tuple<Ts...> get(lua_State* plua, std::index_sequence<Is...>)
+        {
+            constexpr int first = -static_cast<int>(sizeof...(Ts));
+            return std::tuple<Ts...>(get_value<Ts>(plua, first + static_cast<int>(Is))...);
+        }
+    };
+
+    template <typename T1, typename T2>
+    struct LuaResultGetter<std::pair<T1, T2>>
+    {
+        static std::pair<T1, T2> get(lua_State* plua)
+        {
+            auto values = LuaResultGetter<std::tuple<T1, T2>>::get(plua);
+            return std::pair<T1, T2>(std::move(std::get<0>(values)),
+                                     std::move(std::get<1>(values)));
+        }
+    };
+
+
+    /**
+     * How the arguments of an exported function are converted, chosen at
+     * compile time per export:
+     * - lenient: converts whatever is passed (nil becomes 0 or "", ...).
+     * - strict: checks the amount of arguments and their types (including
+     *   integer ranges, container elements and struct fields), raises an
+     *   error in Lua on a mismatch.
+     * - unchecked: no checks at all, for trusted scripts only. Passing the
+     *   wrong types results in garbage values (or worse, for strings).
+     */
+    enum class LuaArgPolicy
+    {
+        lenient,
+        strict,
+        unchecked
     };
 
-    template <typename FirstParamType,
-              typename... RestParamTypes,
-              typename... AccumParamTypes>
-    struct do_fetch_params<std::tuple<FirstParamType, RestParamTypes...>,
-                           std::tuple<AccumParamTypes...>>
+
+    /**
+     * Name of the running C function as it was called in Lua, for error
+     * messages.
+     */
+    inline std::string current_function_name(lua_State* plua)
     {
-        auto operator()(lua_State* plua_state, int i,
-                        std::tuple<AccumParamTypes...>&& params)
+        lua_Debug ar;
+        if (lua_getstack(plua, 0, &ar) && lua_getinfo(plua, "n", &ar) && ar.name)
         {
-            using ParamTypes = std::tuple<AccumParamTypes...>;
-            auto params_updated = do_fetch_param<FirstParamType>(
-                plua_state, i,
-                std::forward<ParamTypes>(params));
-            return do_fetch_params<std::tuple<RestParamTypes...>,
-                                   decltype(params_updated)>{}(
-                                       plua_state, i + 1,
-                                       std::forward<decltype(params_updated)>(params_updated));
+            return ar.name;
         }
+        return "?";
+    }
+
+    /**
+     * Raises a LuaError for a bad argument of the running C function,
+     * formatted like luaL_argerror.
+     */
+    [[noreturn]] inline void throw_arg_error(lua_State* plua, int arg, const std::string& msg)
+    {
+        throw LuaError("bad argument #" + std::to_string(arg) + " to '"
+                       + current_function_name(plua) + "' (" + msg + ")");
+    }
+
+    /**
+     * Raises a LuaError for a value of the wrong type.
+     */
+    [[noreturn]] inline void throw_type_error(lua_State* plua, int location, const char* expected)
+    {
+        throw LuaError(std::string(expected) + " expected, got " + luaL_typename(plua, location));
+    }
+
+    inline void check_arg_count(lua_State* plua, int expected)
+    {
+        const int actual = lua_gettop(plua);
+        if (actual != expected)
+        {
+            throw LuaError("wrong number of arguments to '" + current_function_name(plua)
+                           + "' (expected " + std::to_string(expected)
+                           + ", got " + std::to_string(actual) + ")");
+        }
+    }
+
+    /**
+     * Checks that a value of the Lua stack can be converted to T without
+     * loss, including the elements of containers and the fields of structs.
+     * Raises a LuaError describing the first mismatch otherwise.
+     */
+    template <typename T>
+    struct LuaValueChecker
+    {
+        static void check(lua_State* plua, int location);
     };
 
-    template <typename... ParamTypes>
-    auto fetch_params(lua_State *plua_state)
+    inline void check_nested_table(lua_State* plua, int location, int slots)
     {
-        return do_fetch_params<std::tuple<ParamTypes...>,
-                               std::tuple<>>{}(plua_state, 0, std::make_tuple());
+        if (lua_type(plua, location) != LUA_TTABLE) { throw_type_error(plua, location, "table"); }
+        if (!lua_checkstack(plua, slots)) { throw LuaError("too many nested containers"); }
     }
 
-    template <typename ReturnType, typename... ParamTypes, size_t... Is>
-    auto apply_function(lua_State* plua_state,
-                ExportableFunction<ReturnType, ParamTypes...> f,
-                std::tuple<ParamTypes...>&& params,
-                std::index_sequence<Is...>)
+    template <typename T>
+    void check_sequence(lua_State* plua, int location, size_t max_size)
     {
-        try
+        check_nested_table(plua, location, 1);
+        const int table = lua_absindex(plua, location);
+        const size_t size = std::min(lua_rawlen(plua, table), max_size);
+        for (size_t i = 1; i <= size; ++i)
         {
-            if constexpr (std::is_void<ReturnType>::value)
+            lua_rawgeti(plua, table, static_cast<lua_Integer>(i));
+            try
             {
-                f(std::get<Is>(params)...);
-                return;
+                LuaValueChecker<T>::check(plua, -1);
             }
-            else
+            catch (const LuaError& e)
             {
-                return f(std::get<Is>(params)...);
+                throw LuaError("element " + std::to_string(i) + ": " + e.what());
             }
+            lua_pop(plua, 1);
         }
-        catch(const std::exception& e)
+    }
+
+    template <typename K, typename V>
+    void check_map(lua_State* plua, int location)
+    {
+        check_nested_table(plua, location, 2);
+        const int table = lua_absindex(plua, location);
+        lua_pushnil(plua);
+        while (lua_next(plua, table))
         {
-            push_on_stack(plua_state, e.what());
-            lua_error(plua_state);
+            try
+            {
+                LuaValueChecker<K>::check(plua, -2);
+            }
+            catch (const LuaError& e)
+            {
+                throw LuaError(std::string("key: ") + e.what());
+            }
+            try
+            {
+                LuaValueChecker<V>::check(plua, -1);
+            }
+            catch (const LuaError& e)
+            {
+                throw LuaError(std::string("value: ") + e.what());
+            }
+            lua_pop(plua, 1);
         }
-
-        throw lpp::LuaError("Received unknown error during apply_function!");
     }
 
-    template <typename ReturnType, typename... ParamTypes>
-    int call_helper(lua_State* plua_state)
+    template <typename Field>
+    void check_field(lua_State* plua, int table, size_t name_index, const Field& field)
     {
-        using Function = ExportableFunction<ReturnType, ParamTypes...>;
-        auto f = *reinterpret_cast<Function*>(lua_touserdata(plua_state, lua_upvalueindex(1)));
-        constexpr size_t num_args = sizeof...(ParamTypes);
-        constexpr auto indices = std::make_index_sequence<num_args>{};
-
-        if constexpr (std::is_void<ReturnType>::value)
+        lua_rawgeti(plua, -1, static_cast<lua_Integer>(name_index));
+        lua_rawget(plua, table);
+        if (!lua_isnil(plua, -1))
         {
-            if constexpr (num_args == 0)
+            try
             {
-                auto params = std::make_tuple();
-                apply_function(plua_state, f, std::forward<decltype(params)>(params), indices);
-                return 1;
+                LuaValueChecker<typename Field::MemberType>::check(plua, -1);
             }
-            else
+            catch (const LuaError& e)
             {
-                auto params = fetch_params<ParamTypes...>(plua_state);
-                apply_function(plua_state, f, std::forward<decltype(params)>(params), indices);
-                lua_pop(plua_state, num_args);
-                return 1;
+                throw LuaError(std::string("field '") + field.name + "': " + e.what());
             }
         }
+        lua_pop(plua, 1);
+    }
+
+    template <typename T, size_t... Is>
+    void check_struct(lua_State* plua, int location, std::index_sequence<Is...>)
+    {
+        check_nested_table(plua, location, 2);
+        const int table = lua_absindex(plua, location);
+        LuaStructNames<T>::push(plua);
+        (check_field(plua, table, Is + 1, std::get<Is>(LuaStruct<T>::fields)), ...);
+        lua_pop(plua, 1);
+    }
+
+    template <typename T>
+    void LuaValueChecker<T>::check(lua_State* plua, int location)
+    {
+        if constexpr (is_lua_integer<T>)
+        {
+            get_integer_checked<T>(plua, location);
+        }
+        else if constexpr (std::is_floating_point<T>::value)
+        {
+            if (lua_type(plua, location) != LUA_TNUMBER) { throw_type_error(plua, location, "number"); }
+        }
+        else if constexpr (std::is_same<T, bool>::value)
+        {
+            if (!lua_isboolean(plua, location)) { throw_type_error(plua, location, "boolean"); }
+        }
+        else if constexpr (std::is_same<T, std::string>::value || is_lua_string_view<T>)
+        {
+            if (lua_type(plua, location) != LUA_TSTRING) { throw_type_error(plua, location, "string"); }
+        }
+        else if constexpr (std::is_pointer<T>::value)
+        {
+            if (!to_lua_object<std::remove_pointer_t<T>>(plua, location))
+            {
+                throw_type_error(plua, location, "object");
+            }
+        }
+        else if constexpr (is_lua_struct<T>)
+        {
+            check_struct<T>(plua, location, std::make_index_sequence<lua_field_count<T>>());
+        }
+    }
+
+    template <typename T>
+    struct LuaValueChecker<std::vector<T>>
+    {
+        static void check(lua_State* plua, int location)
+        {
+            check_sequence<T>(plua, location, std::numeric_limits<size_t>::max());
+        }
+    };
+
+    template <typename T, size_t N>
+    struct LuaValueChecker<std::array<T, N>>
+    {
+        static void check(lua_State* plua, int location)
+        {
+            check_sequence<T>(plua, location, N);
+        }
+    };
+
+    template <typename K, typename V>
+    struct LuaValueChecker<std::map<K, V>>
+    {
+        static void check(lua_State* plua, int location)
+        {
+            check_map<K, V>(plua, location);
+        }
+    };
+
+    template <typename K, typename V>
+    struct LuaValueChecker<std::unordered_map<K, V>>
+    {
+        static void check(lua_State* plua, int location)
+        {
+            check_map<K, V>(plua, location);
+        }
+    };
+
+    template <typename T>
+    struct LuaValueChecker<LuaBuffer<T>>
+    {
+        static void check(lua_State* plua, int location)
+        {
+            if (!to_lua_buffer<T>(plua, location)) { throw_type_error(plua, location, "buffer"); }
+        }
+    };
+
+#ifdef __cpp_lib_span
+    template <typename T>
+    struct LuaValueChecker<std::span<T>>
+    {
+        static void check(lua_State* plua, int location)
+        {
+            LuaValueChecker<LuaBuffer<std::remove_const_t<T>>>::check(plua, location);
+        }
+    };
+#endif
+
+    /**
+     * Checks that an argument can be converted to T without loss.
+     */
+    template <typename T>
+    void check_arg(lua_State* plua, int arg)
+    {
+        try
+        {
+            LuaValueChecker<T>::check(plua, arg);
+        }
+        catch (const LuaError& e)
+        {
+            throw_arg_error(plua, arg, e.what());
+        }
+    }
+
+    /**
+     * Gets an argument of the Lua stack assuming it has the right type.
+     */
+    template <typename T>
+    T get_value_unchecked(lua_State* plua, int location)
+    {
+        if constexpr (is_lua_integer<T>)
+        {
+            return static_cast<T>(lua_tointeger(plua, location));
+        }
+        else if constexpr (std::is_floating_point<T>::value)
+        {
+            return static_cast<T>(lua_tonumber(plua, location));
+        }
+        else if constexpr (std::is_same<T, bool>::value)
+        {
+            return lua_toboolean(plua, location) != 0;
+        }
+        else if constexpr (std::is_same<T, std::string>::value
+                        || std::is_same<T, std::string_view>::value)
+        {
+            size_t length = 0;
+            const char* str = lua_tolstring(plua, location, &length);
+            return T(str, length);
+        }
+        else
+        {
+            return get_value<T>(plua, location);
+        }
+    }
+
+    template <LuaArgPolicy Policy, typename T>
+    T get_arg(lua_State* plua, int arg)
+    {
+        if constexpr (Policy == LuaArgPolicy::unchecked)
+        {
+            return get_value_unchecked<T>(plua, arg);
+        }
+        else
+        {
+            if constexpr (Policy == LuaArgPolicy::strict) { check_arg<T>(plua, arg); }
+            return get_value<T>(plua, arg);
+        }
+    }
+
+
+    /**
+     * Pushes an error message for Lua from a catch block. Pushing is done in
+     * protected mode: if it fails (out of memory), the memory error message
+     * is pushed instead of longjmp'ing out of the catch block.
+     */
+    inline int do_push_message(lua_State* plua)
+    {
+        lua_pushstring(plua, static_cast<const char*>(lua_touserdata(plua, 1)));
+        return 1;
+    }
+
+    inline void push_error_message(lua_State* plua, const char* msg) noexcept
+    {
+        // Neither push allocates, they fit in the LUA_MINSTACK slots.
+        lua_pushcfunction(plua, &do_push_message);
+        lua_pushlightuserdata(plua, const_cast<char*>(msg));
+        lua_pcall(plua, 1, 1, 0);
+    }
+
+    /**
+     * Returned by call_helper when the called C++ code raised an exception,
+     * the error message is on top of the stack then.
+     */
+    constexpr int CPP_ERROR = -1;
+
+    /**
+     * Raises the error of a failed call_helper, or returns its amount of
+     * results. Only called from the trampolines themselves, once every C++
+     * frame of the call is unwound, so lua_error never skips destructors.
+     */
+    inline int forward_results(lua_State* plua, int results)
+    {
+        if (results == CPP_ERROR) { return lua_error(plua); }
+        return results;
+    }
+
+    template <typename T>
+    int do_push_results(lua_State* plua)
+    {
+        return push_results(plua, *static_cast<const T*>(lua_touserdata(plua, 1)));
+    }
+
+    /**
+     * Pushes the result of a C++ function. Results that have to be
+     * destroyed are pushed in protected mode, so a memory error while
+     * pushing them can not longjmp over their destructor. Returns CPP_ERROR
+     * with the error message on top of the stack if pushing failed.
+     */
+    template <typename T>
+    int push_results_protected(lua_State* plua, const T& value)
+    {
+        if constexpr (std::is_trivially_destructible<T>::value)
+        {
+            return push_results(plua, value);
+        }
+        else
+        {
+            const int top = lua_gettop(plua);
+            // Neither push allocates, they fit in the LUA_MINSTACK slots.
+            lua_pushcfunction(plua, &do_push_results<T>);
+            lua_pushlightuserdata(plua, const_cast<T*>(&value));
+            if (lua_pcall(plua, 1, LUA_MULTRET, 0) != LUA_OK) { return CPP_ERROR; }
+            return lua_gettop(plua) - top;
+        }
+    }
+
+    /**
+     * True for argument types that are converted without allocating.
+     */
+    template <typename T>
+    constexpr bool is_nothrow_lua_arg = std::is_arithmetic<T>::value
+                                     || std::is_pointer<T>::value
+                                     || std::is_same<T, std::string_view>::value;
+
+    /**
+     * True if converting the arguments, calling f and pushing its result
+     * can never throw, in which case no exception handling code is
+     * generated for it at all.
+     */
+    template <LuaArgPolicy Policy, typename Function, typename ReturnType, typename... ParamTypes>
+    constexpr bool is_nothrow_call =
+        Policy != LuaArgPolicy::strict
+        && (is_nothrow_lua_arg<std::decay_t<ParamTypes>> && ...)
+        && (std::is_void<ReturnType>::value || std::is_trivially_destructible<ReturnType>::value)
+        && noexcept(std::declval<Function&>()(std::declval<std::decay_t<ParamTypes>>()...));
+
+    template <LuaArgPolicy Policy, typename ReturnType, typename... ParamTypes,
+              typename Function, size_t... Is>
+    int invoke_function(lua_State* plua_state, Function& f, std::index_sequence<Is...>)
+    {
+        // NOTE: every argument is converted once, straight from its stack
+        // slot into the parameter of f. The arguments are left on the
+        // stack, Lua only uses the results on top of them.
+        if constexpr (Policy == LuaArgPolicy::strict)
+        {
+            check_arg_count(plua_state, static_cast<int>(sizeof...(ParamTypes)));
+        }
+
+        if constexpr (std::is_void<ReturnType>::value)
+        {
+            f(get_arg<Policy, std::decay_t<ParamTypes>>(plua_state, static_cast<int>(Is) + 1)...);
+            return 0;
+        }
+        else
+        {
+            const auto& result = f(get_arg<Policy, std::decay_t<ParamTypes>>(
+                                       plua_state, static_cast<int>(Is) + 1)...);
+            return push_results_protected(plua_state, result);
+        }
+    }
+
+    /**
+     * Calls f with the arguments on the stack and pushes its results.
+     * Exceptions never leave this function, they are turned into an error
+     * message and CPP_ERROR instead (see forward_results).
+     */
+    template <LuaArgPolicy Policy, typename ReturnType, typename... ParamTypes,
+              typename Function, size_t... Is>
+    int call_helper(lua_State* plua_state, Function& f, std::index_sequence<Is...> indices)
+    {
+        if constexpr (is_nothrow_call<Policy, Function, ReturnType, ParamTypes...>)
+        {
+            return invoke_function<Policy, ReturnType, ParamTypes...>(plua_state, f, indices);
+        }
         else
         {
-            if constexpr (num_args == 0)
+            try
             {
-                auto params = std::make_tuple();
-                auto result = apply_function(plua_state, f, std::forward<decltype(params)>(params), indices);
-                push_on_stack(plua_state, result);
-                return 1;
+                return invoke_function<Policy, ReturnType, ParamTypes...>(plua_state, f, indices);
             }
-            else
+            catch (const std::exception& e)
             {
-                auto params = fetch_params<ParamTypes...>(plua_state);
-                auto result = apply_function(plua_state, f, std::forward<decltype(params)>(params), indices);
-                lua_pop(plua_state, num_args);
-                push_on_stack(plua_state, result);
-                return 1;
+                push_error_message(plua_state, e.what());
             }
+            catch (...)
+            {
+                push_error_message(plua_state, "unknown C++ exception");
+            }
+            return CPP_ERROR;
         }
     }
 
-    template <typename ReturnType, typename... ParamTypes>
+    template <LuaArgPolicy Policy, typename ReturnType, typename... ParamTypes, typename Function>
+    int call_helper(lua_State* plua_state, Function& f)
+    {
+        return call_helper<Policy, ReturnType, ParamTypes...>(
+            plua_state, f, std::index_sequence_for<ParamTypes...>{});
+    }
+
+    template <LuaArgPolicy Policy, typename ReturnType, typename... ParamTypes>
     int do_call(lua_State* plua_state)
     {
-        return call_helper<ReturnType, ParamTypes...>(plua_state);
+        using Function = ExportableFunction<ReturnType, ParamTypes...>;
+        auto f = reinterpret_cast<Function>(lua_touserdata(plua_state, lua_upvalueindex(1)));
+        return forward_results(plua_state, call_helper<Policy, ReturnType, ParamTypes...>(plua_state, f));
+    }
+
+    template <LuaArgPolicy Policy, typename Callable, typename ReturnType, typename... ParamTypes>
+    int do_call_closure(lua_State* plua_state)
+    {
+        auto& f = *static_cast<Callable*>(lua_touserdata(plua_state, lua_upvalueindex(1)));
+        return forward_results(plua_state, call_helper<Policy, ReturnType, ParamTypes...>(plua_state, f));
     }
 
     // Helper function to export C++ functions to Lua.
-    template <typename ReturnType, typename... ParamTypes>
+    template <LuaArgPolicy Policy, typename ReturnType, typename... ParamTypes>
     void export_function_helper(lua_State* plua_state,
                                 ExportableFunction<ReturnType, ParamTypes...> f,
                                 std::string&& lua_function_name)
     {
         assert(plua_state && "Lua state not allowed to be nullptr!");
         assert(f && "Function not allowed to be nullptr!");
-        lua_pushlightuserdata(plua_state, &f);
-        lua_pushcclosure(plua_state, &do_call<ReturnType, ParamTypes...>, 1);
+        // NOTE: the function pointer itself is stored, so nothing is
+        // allocated. (POSIX guarantees function pointers fit in a void*.)
+        lua_pushlightuserdata(plua_state, reinterpret_cast<void*>(f));
+        lua_pushcclosure(plua_state, &do_call<Policy, ReturnType, ParamTypes...>, 1);
+        lua_setglobal(plua_state, lua_function_name.c_str());
+    }
+
+
+    /**
+     * Calls the function F, known at compile time, so the call can be
+     * inlined into the trampoline.
+     */
+    template <auto F>
+    struct LuaStaticFunction
+    {
+        template <typename... Args>
+        decltype(auto) operator()(Args&&... args) const
+            noexcept(noexcept(F(std::forward<Args>(args)...)))
+        {
+            return F(std::forward<Args>(args)...);
+        }
+    };
+
+    template <auto F, LuaArgPolicy Policy, typename ReturnType, typename... ParamTypes>
+    int do_call_static(lua_State* plua_state)
+    {
+        LuaStaticFunction<F> f;
+        return forward_results(plua_state, call_helper<Policy, ReturnType, ParamTypes...>(plua_state, f));
+    }
+
+
+    /**
+     * Metatable destroying callables exported to Lua (lambdas with captures,
+     * functors, std::function) when their closure is collected. Created once
+     * per Lua instance, using the address of 'key' as registry key.
+     */
+    template <typename Callable>
+    struct LuaCallableMetatable
+    {
+        static inline const char key = 0;
+
+        static void push(lua_State* plua)
+        {
+            if (lua_rawgetp(plua, LUA_REGISTRYINDEX, &key) != LUA_TNIL) { return; }
+            lua_pop(plua, 1);
+
+            lua_createtable(plua, 0, 1);
+            lua_pushcfunction(plua, &gc);
+            lua_setfield(plua, -2, "__gc");
+            lua_pushvalue(plua, -1);
+            lua_rawsetp(plua, LUA_REGISTRYINDEX, &key);
+        }
+
+        static int gc(lua_State* plua)
+        {
+            auto pcallable = static_cast<Callable*>(lua_touserdata(plua, 1));
+            pcallable->~Callable();
+            return 0;
+        }
+    };
+
+    template <typename ReturnType, typename... ParamTypes>
+    struct LuaSignature {};
+
+    /**
+     * Deduces the signature of a callable from its (non-overloaded, non
+     * template) call operator.
+     */
+    template <typename Callable>
+    struct LuaCallableTraits : LuaCallableTraits<decltype(&Callable::operator())> {};
+
+    template <typename Class, typename ReturnType, typename... ParamTypes>
+    struct LuaCallableTraits<ReturnType (Class::*)(ParamTypes...)>
+    {
+        using Signature = LuaSignature<ReturnType, ParamTypes...>;
+    };
+    template <typename Class, typename ReturnType, typename... ParamTypes>
+    struct LuaCallableTraits<ReturnType (Class::*)(ParamTypes...) const>
+        : LuaCallableTraits<ReturnType (Class::*)(ParamTypes...)> {};
+    template <typename Class, typename ReturnType, typename... ParamTypes>
+    struct LuaCallableTraits<ReturnType (Class::*)(ParamTypes...) noexcept>
+        : LuaCallableTraits<ReturnType (Class::*)(ParamTypes...)> {};
+    template <typename Class, typename ReturnType, typename... ParamTypes>
+    struct LuaCallableTraits<ReturnType (Class::*)(ParamTypes...) const noexcept>
+        : LuaCallableTraits<ReturnType (Class::*)(ParamTypes...)> {};
+
+    template <typename Function>
+    struct LuaFunctionTraits {};
+
+    template <typename ReturnType, typename... ParamTypes>
+    struct LuaFunctionTraits<ReturnType (*)(ParamTypes...)>
+    {
+        using Signature = LuaSignature<ReturnType, ParamTypes...>;
+    };
+    template <typename ReturnType, typename... ParamTypes>
+    struct LuaFunctionTraits<ReturnType (*)(ParamTypes...) noexcept>
+        : LuaFunctionTraits<ReturnType (*)(ParamTypes...)> {};
+
+    // Helper function to export a C++ function known at compile time to Lua,
+    // the generated C function needs no upvalue.
+    template <auto F, LuaArgPolicy Policy, typename ReturnType, typename... ParamTypes>
+    void export_static_function_helper(lua_State* plua_state,
+                                       std::string&& lua_function_name,
+                                       LuaSignature<ReturnType, ParamTypes...>)
+    {
+        assert(plua_state && "Lua state not allowed to be nullptr!");
+        lua_CFunction trampoline = &do_call_static<F, Policy, ReturnType, ParamTypes...>;
+        lua_pushcfunction(plua_state, trampoline);
         lua_setglobal(plua_state, lua_function_name.c_str());
     }
+
+    template <LuaArgPolicy Policy, typename Callable, typename ReturnType, typename... ParamTypes>
+    void export_callable_helper(lua_State* plua_state,
+                                Callable&& f,
+                                std::string&& lua_function_name,
+                                LuaSignature<ReturnType, ParamTypes...>)
+    {
+        using Function = ExportableFunction<ReturnType, ParamTypes...>;
+        using Stored = std::decay_t<Callable>;
+        assert(plua_state && "Lua state not allowed to be nullptr!");
+
+        if constexpr (std::is_empty<Stored>::value && std::is_convertible<Stored, Function>::value)
+        {
+            // Stateless lambda: exported as plain function pointer
+            export_function_helper<Policy>(plua_state, static_cast<Function>(f),
+                                   std::forward<std::string>(lua_function_name));
+        }
+        else
+        {
+            static_assert(alignof(Stored) <= std::max(alignof(lua_Number), alignof(void*)),
+                          "Lua userdata is not aligned enough for this callable!");
+
+            // The callable is moved into a userdata, kept alive as upvalue of
+            // the exported closure.
+            void* pmemory = lua_newuserdata(plua_state, sizeof(Stored));
+            new (pmemory) Stored(std::forward<Callable>(f));
+            if constexpr (!std::is_trivially_destructible<Stored>::value)
+            {
+                LuaCallableMetatable<Stored>::push(plua_state);
+                lua_setmetatable(plua_state, -2);
+            }
+            lua_pushcclosure(plua_state, &do_call_closure<Policy, Stored, ReturnType, ParamTypes...>, 1);
+            lua_setglobal(plua_state, lua_function_name.c_str());
+        }
+    }
+
+    /**
+     * True for callables exported as closure: anything with a call operator,
+     * except (pointers to) plain functions.
+     */
+    template <typename Callable>
+    constexpr bool is_lua_callable = std::is_class<std::decay_t<Callable>>::value;
 }
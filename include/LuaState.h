@@ -1,11 +1,32 @@
 #pragma once
+#include <memory>
 #include <string>
+#include <LuaAllocator.h>
+#include <LuaCoroutine.hpp>
 #include <LuaFunctionBuilder.hpp>
+#include <LuaLibs.h>
+#include <LuaMemoryTracker.h>
 #include <LuaStack.h>
 
 
 namespace lpp
 {
+    /**
+     * Options for creating a LuaState.
+     *
+     * Lazily opened libraries are looked up through a metatable on _G,
+     * which replaces any metatable set on _G before. A script or embedder
+     * setting its own metatable on _G replaces it in turn, libraries not
+     * opened by then are no longer available as globals (require still
+     * opens them).
+     */
+    struct LuaStateOptions
+    {
+        std::shared_ptr<LuaAllocator> pallocator;  // nullptr: use realloc
+        LuaLibs libs = LuaLibs::all;               // Standard libraries to open
+        bool lazy_libs = false;                    // Open libraries on first use
+    };
+
     /**
      * Class responsible for managing a Lua instance.
      * Provides high level functions for interfacing with the Lua side of things.
@@ -17,6 +38,19 @@ namespace lpp
          * Initializes the LuaState.
          */
         LuaState();
+
+        /**
+         * Initializes the LuaState, all memory used by Lua is allocated
+         * through the given allocator (e.g. a LuaSlabAllocator).
+         * Memory usage is tracked regardless of the allocator used.
+         */
+        explicit LuaState(std::shared_ptr<LuaAllocator> pallocator);
+
+        /**
+         * Initializes the LuaState with the given allocator and standard
+         * libraries (see LuaStateOptions).
+         */
+        explicit LuaState(const LuaStateOptions& options);
         LuaState(const LuaState& other) = delete;
         LuaState& operator=(const LuaState& other) = delete;
         LuaState(LuaState&& other) noexcept = default;
@@ -37,11 +71,35 @@ namespace lpp
          */
         void run_file(const std::string& script_path) const;
 
+        /**
+         * Loads a Lua script from a file and runs it, unless it was already
+         * primed before and did not change since then.
+         */
+        void prime_file(const std::string& script_path) const;
+
         /**
          * Runs a script from a Lua string in memory.
          */
         void run_string(const std::string& script_code) const;
 
+        /**
+         * Enables loading scripts through an on-disk bytecode cache, which
+         * can be shared between states. Passing nullptr disables it again.
+         */
+        void set_bytecode_cache(std::shared_ptr<const LuaBytecodeCache> pcache) const;
+
+        /**
+         * Sets when tracebacks are captured for errors, see
+         * LuaStack::set_traceback_mode.
+         */
+        void set_traceback_mode(LuaTraceback mode, uint32_t sample_every = 1) const;
+
+        /**
+         * Limits the instructions and wall-clock time of every call, see
+         * LuaStack::set_budget. Passing an empty LuaBudget removes the limits.
+         */
+        void set_budget(const LuaBudget& budget) const;
+
         /**
          * Helper function for importing a Lua function into C++.
          * Returns a builder object which can create a Lua function with a
@@ -49,22 +107,96 @@ namespace lpp
          */
         LuaFunctionBuilder import_function_from(std::string&& file) const;
 
+        /**
+         * Creates a coroutine running the global Lua function with the given
+         * name. T is the type of the values it yields and returns, Ts the
+         * types it is resumed with (see LuaCoroutine).
+         */
+        template <typename T, typename... Ts>
+        LuaCoroutine<T, Ts...> make_coroutine(const std::string& function_name) const
+        {
+            m_pstack->get_global(function_name);
+            return LuaCoroutine<T, Ts...>(m_pstack);
+        }
+
+        /**
+         * Current and peak memory usage of this Lua instance.
+         */
+        const LuaMemoryStats& memory_stats() const;
+
+        /**
+         * Limits the memory this Lua instance can use to 'max_bytes',
+         * 0 removes the limit. Going over the limit raises a LuaMemoryError.
+         */
+        void set_memory_limit(size_t max_bytes) const;
+
         /**
          * Get the interface to the lower level Lua stack.
          */
         const std::shared_ptr<LuaStack>& get_stack() const;
 
         /**
-         * Exports a function from C++ to Lua.
+         * Exports a function from C++ to Lua. The policy decides how its
+         * arguments are checked, e.g.:
+         * export_function<LuaArgPolicy::strict>(add, "add").
          */
-        template <typename ReturnType, typename... ParameterTypes>
+        template <LuaArgPolicy Policy = LuaArgPolicy::lenient,
+                  typename ReturnType, typename... ParameterTypes>
         void export_function(ExportableFunction<ReturnType, ParameterTypes...> f,
                              std::string&& lua_function_name) const
         {
-            m_pstack->export_function(f, std::forward<std::string>(lua_function_name));
+            m_pstack->export_function<Policy>(f, std::forward<std::string>(lua_function_name));
+        }
+
+        /**
+         * Exports a function known at compile time from C++ to Lua, e.g.
+         * export_function<&add>("add"). Calls are direct, so small functions
+         * can be inlined.
+         */
+        template <auto F, LuaArgPolicy Policy = LuaArgPolicy::lenient>
+        void export_function(std::string&& lua_function_name) const
+        {
+            m_pstack->export_function<F, Policy>(std::forward<std::string>(lua_function_name));
+        }
+
+        /**
+         * Exports a lambda, functor or std::function from C++ to Lua. The
+         * callable is moved into Lua and destroyed along with the exported
+         * function. (Lambdas without captures are exported as plain
+         * functions.)
+         */
+        template <LuaArgPolicy Policy = LuaArgPolicy::lenient, typename Callable,
+                  typename = std::enable_if_t<is_lua_callable<Callable>>>
+        void export_function(Callable&& f, std::string&& lua_function_name) const
+        {
+            m_pstack->export_function<Policy>(std::forward<Callable>(f),
+                                      std::forward<std::string>(lua_function_name));
+        }
+
+        /**
+         * Exports a C++ function returning a std::future to Lua, calls
+         * suspend the calling coroutine until the result is available (see
+         * LuaStack::export_async_function).
+         */
+        template <LuaArgPolicy Policy = LuaArgPolicy::lenient, typename Callable>
+        void export_async_function(Callable&& f, std::string&& lua_function_name) const
+        {
+            m_pstack->export_async_function<Policy>(std::forward<Callable>(f),
+                                            std::forward<std::string>(lua_function_name));
+        }
+
+        /**
+         * Exports a C++ class to Lua, returns a builder for registering its
+         * constructor, methods and properties.
+         */
+        template <typename T>
+        LuaClass<T> register_class(std::string&& lua_class_name) const
+        {
+            return m_pstack->register_class<T>(std::forward<std::string>(lua_class_name));
         }
 
     private:
+        std::shared_ptr<LuaMemoryTracker> m_pmemory;
         std::shared_ptr<LuaStack> m_pstack;
     };
 }
@@ -0,0 +1,125 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <LuaState.h>
+
+
+namespace lpp
+{
+    /**
+     * Options for creating a LuaStatePool.
+     */
+    struct LuaStatePoolOptions
+    {
+        size_t size = 1;                         // Amount of states in the pool
+        LuaStateOptions state_options;           // Used to create each state
+        std::function<void(LuaState&)> init;     // Ran once for each new state
+        std::function<void(LuaState&)> reset;    // Ran when a state is returned
+        int gc_step_kb = 0;                      // GC step on return, 0 = none
+    };
+
+    /**
+     * Snapshot of the occupancy of a LuaStatePool and the time spent waiting
+     * for a state to become available.
+     */
+    struct LuaStatePoolMetrics
+    {
+        size_t size = 0;                   // Amount of states in the pool
+        size_t in_use = 0;                 // States currently checked out
+        size_t peak_in_use = 0;            // Most states checked out at once
+        uint64_t checkouts = 0;            // Successful checkouts
+        uint64_t timeouts = 0;             // Checkouts that timed out
+        std::chrono::nanoseconds total_wait{ 0 };
+        std::chrono::nanoseconds max_wait{ 0 };
+    };
+
+    /**
+     * Pool of pre-warmed LuaStates. States are created and initialized up
+     * front and handed out through RAII handles, which return the state to
+     * the pool when they go out of scope. Thread-safe.
+     */
+    class LuaStatePool
+    {
+    public:
+        /**
+         * Handle to a checked out LuaState, returns it to the pool when it is
+         * destroyed. An empty handle is returned when a checkout times out.
+         */
+        class Handle
+        {
+        public:
+            Handle() = default;
+            Handle(const Handle&) = delete;
+            Handle& operator=(const Handle&) = delete;
+            Handle(Handle&& other) noexcept;
+            Handle& operator=(Handle&& other) noexcept;
+            ~Handle();
+
+            LuaState& operator*() const { return *m_pstate; }
+            LuaState* operator->() const { return m_pstate; }
+            explicit operator bool() const { return m_pstate != nullptr; }
+
+            /**
+             * Returns the state to the pool before the handle is destroyed.
+             */
+            void release();
+
+        private:
+            friend class LuaStatePool;
+            Handle(LuaStatePool* ppool, LuaState* pstate)
+                : m_ppool(ppool)
+                , m_pstate(pstate) {}
+
+            LuaStatePool* m_ppool = nullptr;
+            LuaState* m_pstate = nullptr;
+        };
+
+        /**
+         * Creates all states and runs the init hook on each of them.
+         */
+        explicit LuaStatePool(LuaStatePoolOptions options);
+        LuaStatePool(const LuaStatePool&) = delete;
+        LuaStatePool& operator=(const LuaStatePool&) = delete;
+        ~LuaStatePool();
+
+        /**
+         * Checks out a state, waits until one is available.
+         * A state that was lost (its reset hook threw and no state could be
+         * made to replace it) is made again here, raising the error if that
+         * fails again.
+         */
+        Handle checkout();
+
+        /**
+         * Checks out a state, waits at most 'timeout' for one to become
+         * available. Returns an empty handle on timeout. Lost states are
+         * made again, like in checkout.
+         */
+        Handle try_checkout(std::chrono::nanoseconds timeout);
+
+        LuaStatePoolMetrics metrics() const;
+
+    private:
+        LuaStatePoolOptions m_options;
+        std::vector<std::unique_ptr<LuaState>> m_states;
+        std::vector<LuaState*> m_available;
+        size_t m_lost_states = 0;  // Empty slots in m_states
+        LuaStatePoolMetrics m_metrics;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_state_returned;
+
+        // Helper functions:
+
+        std::unique_ptr<LuaState> create_state() const;
+        bool can_take_state() const;
+        LuaState* take_or_create_state(std::unique_lock<std::mutex>& lock,
+                                       std::chrono::steady_clock::time_point start);
+        LuaState* take_state(std::chrono::steady_clock::time_point start);
+        void give_back(LuaState* pstate);
+    };
+}
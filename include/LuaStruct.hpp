@@ -0,0 +1,100 @@
+#pragma once
+#include <assert.h>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <lua.hpp>
+
+
+namespace lpp
+{
+    /**
+     * Describes one field of a struct: the key it has in Lua and a pointer
+     * to the member in C++.
+     */
+    template <typename Class, typename Member>
+    struct LuaField
+    {
+        using ClassType = Class;
+        using MemberType = Member;
+
+        const char* name;
+        Member Class::* member;
+    };
+
+    template <typename Class, typename Member>
+    constexpr LuaField<Class, Member> lua_field(const char* name, Member Class::* member)
+    {
+        return LuaField<Class, Member>{ name, member };
+    }
+
+
+    /**
+     * Specialize this for a struct to pass it between C++ and Lua as a table,
+     * by listing its fields once:
+     *
+     *     namespace lpp
+     *     {
+     *         template <>
+     *         struct LuaStruct<Point>
+     *         {
+     *             static constexpr auto fields = std::make_tuple(
+     *                 lua_field("x", &Point::x),
+     *                 lua_field("y", &Point::y));
+     *         };
+     *     }
+     *
+     * Fields missing in a Lua table are left value-initialized.
+     */
+    template <typename T>
+    struct LuaStruct {};
+
+
+    template <typename T, typename = void>
+    struct IsLuaStruct : std::false_type {};
+    template <typename T>
+    struct IsLuaStruct<T, std::void_t<decltype(LuaStruct<T>::fields)>> : std::true_type {};
+
+    /**
+     * True for types with a LuaStruct specialization.
+     */
+    template <typename T>
+    constexpr bool is_lua_struct = IsLuaStruct<T>::value;
+
+    template <typename T>
+    constexpr size_t lua_field_count =
+        std::tuple_size<std::decay_t<decltype(LuaStruct<T>::fields)>>::value;
+
+
+    /**
+     * Field names of a struct, interned once per Lua instance. They are kept
+     * in a sequence in the registry (using the address of 'key' as registry
+     * key), so pushing a name is an array lookup instead of hashing the
+     * string again on every push.
+     */
+    template <typename T>
+    struct LuaStructNames
+    {
+        static inline const char key = 0;
+
+        static void push(lua_State* plua)
+        {
+            if (lua_rawgetp(plua, LUA_REGISTRYINDEX, &key) != LUA_TNIL) { return; }
+            lua_pop(plua, 1);
+
+            lua_createtable(plua, static_cast<int>(lua_field_count<T>), 0);
+            fill(plua, std::make_index_sequence<lua_field_count<T>>());
+            lua_pushvalue(plua, -1);
+            lua_rawsetp(plua, LUA_REGISTRYINDEX, &key);
+        }
+
+    private:
+        template <size_t... Is>
+        static void fill(lua_State* plua, std::index_sequence<Is...>)
+        {
+            ((lua_pushstring(plua, std::get<Is>(LuaStruct<T>::fields).name),
+              lua_rawseti(plua, -2, static_cast<lua_Integer>(Is + 1))), ...);
+        }
+    };
+}
@@ -0,0 +1,27 @@
+#!/bin/bash
+# Measures how long it takes to compile exported functions with 1, 4 and 12
+# parameters (see bench/compile_time/wide_exports.cpp).
+#
+# Usage: CXX=g++ ./scripts/measure_compile_time.sh
+# Clang is asked to use libc++ unless CXXFLAGS is set.
+
+SCRIPT_DIR=$(dirname $0)
+SOURCE=${SCRIPT_DIR}/../bench/compile_time/wide_exports.cpp
+CXX=${CXX:-clang++}
+if [ -z "${CXXFLAGS+set}" ]; then
+    case $(basename ${CXX}) in
+        clang*) CXXFLAGS=-stdlib=libc++ ;;
+        *) CXXFLAGS= ;;
+    esac
+fi
+
+set -e
+echo "${CXX} ${CXXFLAGS} -std=c++2a -O2"
+for ARITY in 1 4 12; do
+    START=$(date +%s%N)
+    ${CXX} ${CXXFLAGS} -std=c++2a -O2 -I${SCRIPT_DIR}/../include -DLPP_ARITY=${ARITY} \
+        -c ${SOURCE} -o /dev/null
+    END=$(date +%s%N)
+    echo "${ARITY} argument(s): $(( (END - START) / 1000000 )) ms"
+done
+exit 0
@@ -0,0 +1,30 @@
+#include <cstdlib>
+#include <LuaAllocator.h>
+
+
+namespace lpp
+{
+    LuaAllocator::~LuaAllocator() {}
+
+    void* LuaAllocator::allocate(void* pallocator,
+                                 void* ptr,
+                                 size_t old_size,
+                                 size_t new_size) noexcept
+    {
+        // For new allocations Lua passes the type of the object as old size.
+        if (ptr == nullptr) { old_size = 0; }
+        return static_cast<LuaAllocator*>(pallocator)->reallocate(ptr, old_size, new_size);
+    }
+
+    void* LuaDefaultAllocator::reallocate(void* ptr,
+                                          size_t,
+                                          size_t new_size) noexcept
+    {
+        if (new_size == 0)
+        {
+            std::free(ptr);
+            return nullptr;
+        }
+        return std::realloc(ptr, new_size);
+    }
+}
@@ -0,0 +1,220 @@
+#include <unistd.h>  // getpid
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <LuaBytecodeCache.h>
+
+
+namespace lpp
+{
+    namespace
+    {
+        // Layout of a cache entry: magic, format version, flags, source hash,
+        // source size, bytecode size, bytecode checksum, bytecode.
+        const char ENTRY_MAGIC[4] = { 'L', 'P', 'P', 'B' };
+        const uint32_t ENTRY_VERSION = 1;
+        const size_t HEADER_SIZE = sizeof(ENTRY_MAGIC) + 2 * sizeof(uint32_t)
+                                 + 4 * sizeof(uint64_t);
+
+        uint64_t fnv1a(const char* data, size_t size,
+                       uint64_t hash = 0xcbf29ce484222325ull)
+        {
+            for (size_t i = 0; i < size; ++i)
+            {
+                hash ^= static_cast<unsigned char>(data[i]);
+                hash *= 0x100000001b3ull;
+            }
+            return hash;
+        }
+
+        template <typename T>
+        void write_field(std::string& out, T value)
+        {
+            out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        T read_field(const char*& in)
+        {
+            T value;
+            std::memcpy(&value, in, sizeof(T));
+            in += sizeof(T);
+            return value;
+        }
+
+        int write_chunk(lua_State*, const void* data, size_t size, void* out)
+        {
+            try
+            {
+                static_cast<std::string*>(out)->append(
+                    static_cast<const char*>(data), size);
+                return 0;
+            }
+            catch (...)
+            {
+                return 1;  // Aborts lua_dump
+            }
+        }
+
+        bool read_file(const std::string& path, std::string& contents)
+        {
+            std::ifstream file(path, std::ios::binary);
+            if (!file) { return false; }
+            contents.assign(std::istreambuf_iterator<char>(file),
+                            std::istreambuf_iterator<char>());
+            return !file.bad();
+        }
+    }
+
+    LuaBytecodeCache::LuaBytecodeCache(const std::string& cache_dir,
+                                       bool strip_debug_info)
+        : m_cache_dir(cache_dir)
+        , m_strip_debug_info(strip_debug_info)
+    {
+        std::error_code err;
+        std::filesystem::create_directories(m_cache_dir, err);
+    }
+
+    int LuaBytecodeCache::load_file(lua_State* plua,
+                                    const std::string& script_path) const
+    {
+        std::string source;
+        if (!read_file(script_path, source))
+        {
+            lua_pushfstring(plua, "cannot open %s: %s",
+                            script_path.c_str(), std::strerror(errno));
+            return LUA_ERRFILE;
+        }
+
+        const std::string chunk_name = "@" + script_path;
+        if (source.compare(0, std::strlen(LUA_SIGNATURE), LUA_SIGNATURE) == 0)
+        {
+            // Already precompiled, nothing to cache.
+            return luaL_loadbufferx(plua, source.data(), source.size(),
+                                    chunk_name.c_str(), "b");
+        }
+        if (!source.empty() && source[0] == '#')
+        {
+            // Skip the shebang line, but keep the newline for line numbers.
+            source.erase(0, source.find('\n'));
+        }
+
+        // The chunk name is part of the key: a dump that keeps debug info
+        // also keeps the name, which shows up in error messages.
+        uint64_t source_hash = fnv1a(source.data(), source.size());
+        source_hash = fnv1a(LUA_VERSION, std::strlen(LUA_VERSION), source_hash);
+        source_hash = fnv1a(chunk_name.data(), chunk_name.size(), source_hash);
+        char key[17];
+        std::snprintf(key, sizeof(key), "%016llx",
+                      static_cast<unsigned long long>(source_hash));
+        auto entry_path = (std::filesystem::path(m_cache_dir)
+                        / (std::string(key) + (m_strip_debug_info ? ".s.luac" : ".luac"))).string();
+
+        if (load_cached(plua, entry_path, chunk_name, source_hash, source.size()))
+        {
+            return LUA_OK;
+        }
+
+        int status = luaL_loadbufferx(plua, source.data(), source.size(),
+                                      chunk_name.c_str(), "t");
+        if (status == LUA_OK)
+        {
+            store(plua, entry_path, source_hash, source.size());
+        }
+        return status;
+    }
+
+    const std::string& LuaBytecodeCache::directory() const
+    {
+        return m_cache_dir;
+    }
+
+    bool LuaBytecodeCache::strips_debug_info() const
+    {
+        return m_strip_debug_info;
+    }
+
+    bool LuaBytecodeCache::load_cached(lua_State* plua,
+                                       const std::string& entry_path,
+                                       const std::string& chunk_name,
+                                       uint64_t source_hash,
+                                       uint64_t source_size) const
+    {
+        std::string entry;
+        if (!read_file(entry_path, entry)) { return false; }
+
+        bool valid = entry.size() >= HEADER_SIZE
+                  && std::memcmp(entry.data(), ENTRY_MAGIC, sizeof(ENTRY_MAGIC)) == 0;
+        const char* in = nullptr;
+        uint64_t bytecode_size = 0;
+        if (valid)
+        {
+            in = entry.data() + sizeof(ENTRY_MAGIC);
+            auto version = read_field<uint32_t>(in);
+            auto stripped = read_field<uint32_t>(in);
+            auto hash = read_field<uint64_t>(in);
+            auto size = read_field<uint64_t>(in);
+            bytecode_size = read_field<uint64_t>(in);
+            auto checksum = read_field<uint64_t>(in);
+
+            valid = version == ENTRY_VERSION
+                 && (stripped != 0) == m_strip_debug_info
+                 && hash == source_hash
+                 && size == source_size
+                 && bytecode_size == entry.size() - HEADER_SIZE
+                 && checksum == fnv1a(in, bytecode_size);
+        }
+        if (valid)
+        {
+            if (luaL_loadbufferx(plua, in, bytecode_size,
+                                 chunk_name.c_str(), "b") == LUA_OK)
+            {
+                return true;
+            }
+            lua_pop(plua, 1);  // Error message, e.g. Lua version mismatch
+        }
+
+        std::error_code err;
+        std::filesystem::remove(entry_path, err);  // Stale or corrupt entry
+        return false;
+    }
+
+    void LuaBytecodeCache::store(lua_State* plua,
+                                 const std::string& entry_path,
+                                 uint64_t source_hash,
+                                 uint64_t source_size) const
+    {
+        std::string bytecode;
+        if (lua_dump(plua, write_chunk, &bytecode, m_strip_debug_info) != 0)
+        {
+            return;
+        }
+
+        std::string entry(ENTRY_MAGIC, sizeof(ENTRY_MAGIC));
+        write_field<uint32_t>(entry, ENTRY_VERSION);
+        write_field<uint32_t>(entry, m_strip_debug_info ? 1 : 0);
+        write_field<uint64_t>(entry, source_hash);
+        write_field<uint64_t>(entry, source_size);
+        write_field<uint64_t>(entry, bytecode.size());
+        write_field<uint64_t>(entry, fnv1a(bytecode.data(), bytecode.size()));
+        entry += bytecode;
+
+        // Write to a temporary file first so readers never see partial entries.
+        auto thread_id = std::hash<std::thread::id>{}(std::this_thread::get_id());
+        auto tmp_path = entry_path + ".tmp." + std::to_string(getpid())
+                      + "." + std::to_string(thread_id);
+        {
+            std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+            if (!file) { return; }
+            file.write(entry.data(), static_cast<std::streamsize>(entry.size()));
+            if (!file) { return; }
+        }
+        std::error_code err;
+        std::filesystem::rename(tmp_path, entry_path, err);
+    }
+}
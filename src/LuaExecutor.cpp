@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <LuaExecutor.h>
+
+
+namespace lpp
+{
+    LuaExecutor::LuaExecutor(LuaExecutorOptions options)
+        : m_next_worker(0)
+        , m_steals(0)
+        , m_pending(0)
+        , m_stopping(false)
+    {
+        size_t num_workers = std::max<size_t>(options.num_workers, 1);
+        m_workers.reserve(num_workers);
+        for (size_t i = 0; i < num_workers; ++i)
+        {
+            auto pworker = std::make_unique<Worker>(options.state_options);
+            for (const auto& script : options.scripts)
+            {
+                pworker->state.prime_file(script);
+            }
+            if (options.init) { options.init(pworker->state); }
+            m_workers.push_back(std::move(pworker));
+        }
+
+        for (size_t i = 0; i < num_workers; ++i)
+        {
+            m_workers[i]->thread = std::thread([this, i] { run(i); });
+        }
+    }
+
+    LuaExecutor::~LuaExecutor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_work_available.notify_all();
+        for (auto& pworker : m_workers) { pworker->thread.join(); }
+    }
+
+    size_t LuaExecutor::num_workers() const
+    {
+        return m_workers.size();
+    }
+
+    uint64_t LuaExecutor::steals() const
+    {
+        return m_steals.load();
+    }
+
+    void LuaExecutor::push_function(Worker& worker, const std::string& func_name)
+    {
+        LuaStack& stack = *worker.state.get_stack();
+        auto it = worker.functions.find(func_name);
+        if (it == worker.functions.end())
+        {
+            stack.get_global(func_name);
+            if (stack.is_nil(-1))
+            {
+                // Not defined (yet), look it up again on the next call
+                return;
+            }
+            it = worker.functions.emplace(func_name, stack.make_ref()).first;
+        }
+        stack.push_ref(it->second);
+    }
+
+    void LuaExecutor::push_task(Task&& task)
+    {
+        auto& worker = *m_workers[m_next_worker++ % m_workers.size()];
+        {
+            // Counted before it can be popped, so m_pending never wraps
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_pending;
+            std::lock_guard<std::mutex> queue_lock(worker.mutex);
+            worker.queue.push_back(std::move(task));
+        }
+        m_work_available.notify_one();
+    }
+
+    bool LuaExecutor::pop_task(size_t index, Task& task)
+    {
+        bool found = false;
+        {
+            auto& worker = *m_workers[index];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            if (!worker.queue.empty())
+            {
+                task = std::move(worker.queue.front());
+                worker.queue.pop_front();
+                found = true;
+            }
+        }
+
+        // Nothing to do, try stealing the newest call of another worker.
+        for (size_t i = 1; !found && i < m_workers.size(); ++i)
+        {
+            auto& victim = *m_workers[(index + i) % m_workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.queue.empty())
+            {
+                task = std::move(victim.queue.back());
+                victim.queue.pop_back();
+                found = true;
+                ++m_steals;
+            }
+        }
+
+        if (found)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_pending;
+        }
+        return found;
+    }
+
+    void LuaExecutor::run(size_t index)
+    {
+        Worker& worker = *m_workers[index];
+        for (;;)
+        {
+            Task task;
+            if (pop_task(index, task))
+            {
+                task(worker);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_available.wait(lock, [this] { return m_stopping || m_pending > 0; });
+            if (m_stopping && m_pending == 0) { return; }
+        }
+    }
+}
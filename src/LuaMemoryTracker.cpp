@@ -0,0 +1,50 @@
+#include <algorithm>
+#include <LuaMemoryTracker.h>
+
+
+namespace lpp
+{
+    LuaMemoryTracker::LuaMemoryTracker(std::shared_ptr<LuaAllocator> pallocator)
+        : m_pallocator(pallocator ? std::move(pallocator)
+                                  : std::make_shared<LuaDefaultAllocator>())
+        , m_limit(0) {}
+
+    void* LuaMemoryTracker::reallocate(void* ptr,
+                                       size_t old_size,
+                                       size_t new_size) noexcept
+    {
+        if (new_size > old_size && m_limit != 0
+            && m_stats.current_bytes - old_size + new_size > m_limit)
+        {
+            ++m_stats.failed_allocations;
+            return nullptr;
+        }
+
+        void* result = m_pallocator->reallocate(ptr, old_size, new_size);
+        if (result == nullptr && new_size != 0)
+        {
+            ++m_stats.failed_allocations;
+            return nullptr;
+        }
+
+        if (ptr == nullptr && new_size != 0) { ++m_stats.allocation_count; }
+        m_stats.current_bytes = m_stats.current_bytes - old_size + new_size;
+        m_stats.peak_bytes = std::max(m_stats.peak_bytes, m_stats.current_bytes);
+        return result;
+    }
+
+    void LuaMemoryTracker::set_limit(size_t max_bytes)
+    {
+        m_limit = max_bytes;
+    }
+
+    size_t LuaMemoryTracker::limit() const
+    {
+        return m_limit;
+    }
+
+    const LuaMemoryStats& LuaMemoryTracker::stats() const
+    {
+        return m_stats;
+    }
+}
@@ -0,0 +1,58 @@
+#include <LuaScheduler.h>
+
+
+namespace lpp
+{
+    namespace
+    {
+        // How long run waits for an async call before polling again
+        constexpr std::chrono::milliseconds WAIT_INTERVAL{ 1 };
+    }
+
+    LuaTask::~LuaTask() = default;
+
+    size_t LuaScheduler::poll()
+    {
+        size_t resumed = 0;
+        for (size_t i = 0; i < m_tasks.size();)
+        {
+            if (!m_tasks[i]->is_ready())
+            {
+                ++i;
+                continue;
+            }
+
+            ++resumed;
+            if (m_tasks[i]->step())
+            {
+                // Order does not matter, swap with the last one. Removed
+                // before finishing, which may add new tasks.
+                std::swap(m_tasks[i], m_tasks.back());
+                auto pfinished = std::move(m_tasks.back());
+                m_tasks.pop_back();
+                pfinished->finish();
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        return resumed;
+    }
+
+    void LuaScheduler::run()
+    {
+        while (!m_tasks.empty())
+        {
+            if (poll() == 0)
+            {
+                m_tasks.front()->wait_for(WAIT_INTERVAL);
+            }
+        }
+    }
+
+    size_t LuaScheduler::size() const
+    {
+        return m_tasks.size();
+    }
+}
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <LuaSlabAllocator.h>
+
+
+namespace lpp
+{
+    LuaSlabAllocator::LuaSlabAllocator(size_t slab_size)
+        : m_slab_size(std::max(slab_size, MAX_SMALL_SIZE))
+    {
+        m_free_lists.fill(nullptr);
+    }
+
+    LuaSlabAllocator::~LuaSlabAllocator()
+    {
+        for (auto slab : m_slabs) { std::free(slab); }
+    }
+
+    void* LuaSlabAllocator::reallocate(void* ptr,
+                                       size_t old_size,
+                                       size_t new_size) noexcept
+    {
+        const bool old_small = ptr != nullptr && old_size <= MAX_SMALL_SIZE;
+        const bool new_small = new_size <= MAX_SMALL_SIZE;
+
+        if (new_size == 0)
+        {
+            if (old_small) { free_small(ptr, size_class(old_size)); }
+            else if (ptr != nullptr) { free_large(ptr); }
+            return nullptr;
+        }
+
+        if (ptr == nullptr)
+        {
+            return new_small ? allocate_small(size_class(new_size))
+                             : allocate_large(new_size);
+        }
+
+        if (!old_small && !new_small)
+        {
+            return std::realloc(ptr, new_size);
+        }
+
+        if (old_small && new_small && size_class(old_size) == size_class(new_size))
+        {
+            return ptr;  // Still fits in the same block
+        }
+
+        void* new_ptr = new_small ? allocate_small(size_class(new_size))
+                                  : allocate_large(new_size);
+        if (new_ptr == nullptr)
+        {
+            if (new_size > old_size) { return nullptr; }
+
+            // Shrinking must never fail, keep the old block. If it came from
+            // malloc it is treated as a small block from now on, so track it
+            // to release it together with the slabs (a slot for it was
+            // reserved when it was allocated).
+            if (!old_small)
+            {
+                --m_large_blocks;
+                m_slabs.push_back(ptr);
+            }
+            return ptr;
+        }
+        std::memcpy(new_ptr, ptr, std::min(old_size, new_size));
+        if (old_small) { free_small(ptr, size_class(old_size)); }
+        else { free_large(ptr); }
+        return new_ptr;
+    }
+
+    size_t LuaSlabAllocator::size_class(size_t size)
+    {
+        return (size + GRANULARITY - 1) / GRANULARITY - 1;
+    }
+
+    void* LuaSlabAllocator::allocate_small(size_t size_class) noexcept
+    {
+        if (m_free_lists[size_class] == nullptr && !add_slab(size_class))
+        {
+            return nullptr;
+        }
+        FreeBlock* block = m_free_lists[size_class];
+        m_free_lists[size_class] = block->next;
+        return block;
+    }
+
+    void LuaSlabAllocator::free_small(void* ptr, size_t size_class) noexcept
+    {
+        auto block = static_cast<FreeBlock*>(ptr);
+        block->next = m_free_lists[size_class];
+        m_free_lists[size_class] = block;
+    }
+
+    void* LuaSlabAllocator::allocate_large(size_t size) noexcept
+    {
+        if (!reserve_slots(1)) { return nullptr; }
+        void* ptr = std::malloc(size);
+        if (ptr != nullptr) { ++m_large_blocks; }
+        return ptr;
+    }
+
+    void LuaSlabAllocator::free_large(void* ptr) noexcept
+    {
+        std::free(ptr);
+        --m_large_blocks;
+    }
+
+    bool LuaSlabAllocator::reserve_slots(size_t amount) noexcept
+    {
+        const size_t needed = m_slabs.size() + m_large_blocks + amount;
+        if (needed <= m_slabs.capacity()) { return true; }
+        try
+        {
+            m_slabs.reserve(2 * needed + 16);
+            return true;
+        }
+        catch (...)
+        {
+            return false;
+        }
+    }
+
+    bool LuaSlabAllocator::add_slab(size_t size_class) noexcept
+    {
+        if (!reserve_slots(1)) { return false; }
+        auto slab = static_cast<char*>(std::malloc(m_slab_size));
+        if (slab == nullptr) { return false; }
+        m_slabs.push_back(slab);  // Never reallocates, see reserve_slots
+
+        // Carve the slab up into blocks and put them on the free list.
+        const size_t block_size = (size_class + 1) * GRANULARITY;
+        const size_t num_blocks = m_slab_size / block_size;
+        for (size_t i = num_blocks; i > 0; --i)
+        {
+            free_small(slab + (i - 1) * block_size, size_class);
+        }
+        return true;
+    }
+}
@@ -1,13 +1,97 @@
+#include <cstring>
+#include <new>
 #include <LuaStack.h>
 
 
 namespace lpp
 {
-    LuaStack::LuaStack(lua_State* const plua)
-        : m_plua(plua)
+    namespace
+    {
+        // Registry key of the LuaStack a message handler reports to
+        const char TRACEBACK_KEY = 0;
+
+        struct LuaLib
+        {
+            LuaLibs lib;
+            const char* name;
+            lua_CFunction open;
+        };
+
+        const LuaLib LUA_LIBS[] = {
+            { LuaLibs::base, "_G", luaopen_base },
+            { LuaLibs::package, LUA_LOADLIBNAME, luaopen_package },
+            { LuaLibs::coroutine, LUA_COLIBNAME, luaopen_coroutine },
+            { LuaLibs::table, LUA_TABLIBNAME, luaopen_table },
+            { LuaLibs::io, LUA_IOLIBNAME, luaopen_io },
+            { LuaLibs::os, LUA_OSLIBNAME, luaopen_os },
+            { LuaLibs::string, LUA_STRLIBNAME, luaopen_string },
+            { LuaLibs::math, LUA_MATHLIBNAME, luaopen_math },
+            { LuaLibs::utf8, LUA_UTF8LIBNAME, luaopen_utf8 },
+            { LuaLibs::debug, LUA_DBLIBNAME, luaopen_debug },
+        };
+
+        void open_lib(lua_State* plua, const LuaLib& lib)
+        {
+            luaL_requiref(plua, lib.name, lib.open, 1);
+            lua_pop(plua, 1);
+        }
+
+        // Lets require open the libraries that were not accessed yet, the
+        // package table is on top of the stack.
+        void preload_libs(lua_State* plua, LuaLibs libs)
+        {
+            lua_getfield(plua, -1, "preload");
+            for (const auto& lib : LUA_LIBS)
+            {
+                if (!contains(libs, lib.lib)
+                    || lib.lib == LuaLibs::base || lib.lib == LuaLibs::package)
+                {
+                    continue;
+                }
+                lua_pushcfunction(plua, lib.open);
+                lua_setfield(plua, -2, lib.name);
+            }
+            lua_pop(plua, 1);
+        }
+
+        // __index metamethod of _G, upvalue 1 = libraries that can be opened.
+        int open_lib_on_access(lua_State* plua)
+        {
+            if (lua_type(plua, 2) != LUA_TSTRING) { return 0; }
+
+            auto libs = static_cast<LuaLibs>(lua_tointeger(plua, lua_upvalueindex(1)));
+            const char* key = lua_tostring(plua, 2);
+            bool is_require = std::strcmp(key, "require") == 0;
+            for (const auto& lib : LUA_LIBS)
+            {
+                if (!contains(libs, lib.lib)) { continue; }
+                if (std::strcmp(key, lib.name) == 0
+                    || (is_require && lib.lib == LuaLibs::package))
+                {
+                    open_lib(plua, lib);
+                    if (lib.lib == LuaLibs::package)
+                    {
+                        lua_pushliteral(plua, LUA_LOADLIBNAME);
+                        lua_rawget(plua, 1);
+                        preload_libs(plua, libs);
+                        lua_pop(plua, 1);
+                    }
+                    lua_rawget(plua, 1);  // Global is set now
+                    return 1;
+                }
+            }
+            return 0;
+        }
+    }
+
+    LuaStack::LuaStack(lua_State* const plua,
+                       std::shared_ptr<LuaAllocator> pallocator,
+                       LuaLibs libs)
+        : m_pallocator(std::move(pallocator))
+        , m_plua(plua)
     {
         assert(m_plua != nullptr);
-        luaL_openlibs(m_plua);  // Load Lua libraries
+        open_libs(libs);  // Load Lua libraries
     }
 
     LuaStack::~LuaStack()
@@ -17,44 +101,150 @@ namespace lpp
 
     void LuaStack::load_file(const std::string& script_path) const
     {
-        if (luaL_loadfile(m_plua, script_path.c_str()) == LUA_OK)
+        int status = m_pbytecode_cache
+                   ? m_pbytecode_cache->load_file(m_plua, script_path)
+                   : luaL_loadfile(m_plua, script_path.c_str());
+        if (status == LUA_OK)
         {
             return;
         }
-        auto err_msg = get<std::string>(-1);
-        throw LuaError(err_msg);
+        throw_error(status);
     }
 
     void LuaStack::run_file(const std::string& script_path) const
     {
-        if (luaL_dofile(m_plua, script_path.c_str()) == LUA_OK)
+        load_file(script_path);
+        int status = protected_call(0, LUA_MULTRET, 0);
+        if (status == LUA_OK)
         {
             return;
         }
-        auto err_msg = get<std::string>(-1);
-        throw LuaError(err_msg);
+        throw_error(status);
+    }
+
+    void LuaStack::prime_file(const std::string& script_path) const
+    {
+        std::error_code err;
+        auto path = std::filesystem::canonical(script_path, err);
+        if (err)
+        {
+            load_file(script_path);  // Let Lua report the error
+            pcall(0, 0, 0);
+            return;
+        }
+
+        auto mtime = std::filesystem::last_write_time(path, err);
+        auto it = m_primed_files.find(path.native());
+        if (!err && it != m_primed_files.end() && it->second == mtime)
+        {
+            return;
+        }
+
+        load_file(script_path);
+        pcall(0, 0, 0);
+        m_primed_files[path.native()] = mtime;
     }
 
     void LuaStack::run_string(const std::string& script_code) const
     {
-        if (luaL_dostring(m_plua, script_code.c_str()) == LUA_OK)
+        int status = luaL_loadstring(m_plua, script_code.c_str());
+        if (status == LUA_OK)
+        {
+            status = protected_call(0, LUA_MULTRET, 0);
+        }
+        if (status == LUA_OK)
         {
             return;
         }
-        auto err_msg = get<std::string>(-1);
-        throw LuaError(err_msg);
+        throw_error(status);
+    }
+
+    void LuaStack::open_libs(LuaLibs libs) const
+    {
+        for (const auto& lib : LUA_LIBS)
+        {
+            if (contains(libs, lib.lib)) { open_lib(m_plua, lib); }
+        }
+    }
+
+    void LuaStack::open_libs_lazily(LuaLibs libs) const
+    {
+        const auto eager_libs = LuaLibs::base | LuaLibs::string;
+        open_libs(libs & eager_libs);
+
+        lua_pushglobaltable(m_plua);
+        lua_createtable(m_plua, 0, 1);
+        lua_pushinteger(m_plua, static_cast<lua_Integer>(libs));
+        lua_pushcclosure(m_plua, open_lib_on_access, 1);
+        lua_setfield(m_plua, -2, "__index");
+        lua_setmetatable(m_plua, -2);
+        lua_pop(m_plua, 1);
+    }
+
+    void LuaStack::set_bytecode_cache(std::shared_ptr<const LuaBytecodeCache> pcache)
+    {
+        m_pbytecode_cache = std::move(pcache);
+    }
+
+    void LuaStack::set_traceback_mode(LuaTraceback mode, uint32_t sample_every)
+    {
+        m_traceback_mode = mode;
+        m_traceback_sample_every = sample_every == 0 ? 1 : sample_every;
+        lua_pushlightuserdata(m_plua, this);
+        lua_rawsetp(m_plua, LUA_REGISTRYINDEX, &TRACEBACK_KEY);
+    }
+
+    void LuaStack::set_budget(const LuaBudget& budget)
+    {
+        m_budget = budget;
+        m_budget.check_every = budget.check_every == 0 ? 1 : budget.check_every;
+        m_budget_exceeded = false;
     }
 
     void LuaStack::pcall(uint32_t param_amount,
                          uint32_t return_amount,
                          int32_t err_handler) const
     {
-        if (lua_pcall(m_plua, param_amount, return_amount, err_handler) == LUA_OK)
+        int status = protected_call(static_cast<int>(param_amount),
+                                    static_cast<int>(return_amount), err_handler);
+        if (status == LUA_OK)
         {
             return;
         }
-        auto err_msg = get<std::string>(-1);
-        throw LuaError(err_msg);
+        throw_error(status);
+    }
+
+    int LuaStack::try_pcall(uint32_t param_amount,
+                            uint32_t return_amount,
+                            int32_t err_handler) const
+    {
+        int status = protected_call(static_cast<int>(param_amount),
+                                    static_cast<int>(return_amount), err_handler);
+        m_traceback.clear();  // Only reported through exceptions
+        return status;
+    }
+
+    bool LuaStack::gc_step(int step_kb) const
+    {
+        return lua_gc(m_plua, LUA_GCSTEP, step_kb) == 1;
+    }
+
+    void LuaStack::push_copy(int location) const
+    {
+        lua_pushvalue(m_plua, location);
+    }
+
+    bool LuaStack::is_nil(int location) const
+    {
+        return lua_isnoneornil(m_plua, location);
+    }
+
+    void LuaStack::reserve(uint32_t amount) const
+    {
+        if (!lua_checkstack(m_plua, static_cast<int>(amount)))
+        {
+            throw LuaError("stack overflow");
+        }
     }
 
     void LuaStack::pop(uint32_t amount) const
@@ -66,5 +256,209 @@ namespace lpp
     {
         lua_getglobal(m_plua, global.c_str());
     }
-}
 
+    void LuaStack::set_global(const std::string& global) const
+    {
+        lua_setglobal(m_plua, global.c_str());
+    }
+
+    int LuaStack::make_ref() const
+    {
+        return luaL_ref(m_plua, LUA_REGISTRYINDEX);
+    }
+
+    void LuaStack::push_ref(int ref) const
+    {
+        lua_rawgeti(m_plua, LUA_REGISTRYINDEX, ref);
+    }
+
+    void LuaStack::release_ref(int ref) const
+    {
+        luaL_unref(m_plua, LUA_REGISTRYINDEX, ref);
+    }
+
+    lua_State* LuaStack::new_thread() const
+    {
+        lua_State* pthread = lua_newthread(m_plua);
+        lua_insert(m_plua, -2);         // Thread below the function
+        lua_xmove(m_plua, pthread, 1);  // Function to the thread
+        return pthread;
+    }
+
+    void LuaStack::throw_error(int status) const
+    {
+        auto err_msg = get<std::string>(-1);
+        pop(1);
+        if (status == LUA_ERRMEM)
+        {
+            throw LuaMemoryError(err_msg);
+        }
+        std::string traceback;
+        traceback.swap(m_traceback);
+        if (status == LUA_ERRRUN && m_budget_exceeded)
+        {
+            throw LuaBudgetError(err_msg, m_exceeded_limit, std::move(traceback));
+        }
+        throw LuaError(err_msg, status, std::move(traceback));
+    }
+
+    int LuaStack::protected_call(int param_amount, int return_amount, int err_handler) const
+    {
+        if (!m_budget.is_limited() || m_budget_running)
+        {
+            return traced_call(param_amount, return_amount, err_handler);
+        }
+
+        start_budget();
+        // Coroutines created during the call copy the extra space and hook
+        install_budget_hook(m_plua);
+
+        int status = traced_call(param_amount, return_amount, err_handler);
+
+        lua_sethook(m_plua, nullptr, 0, 0);
+        m_budget_running = false;
+        return status;
+    }
+
+    int LuaStack::resume(lua_State* pthread, int param_amount) const
+    {
+        if (!m_budget.is_limited())
+        {
+            return lua_resume(pthread, nullptr, param_amount);
+        }
+
+        // Resumed from a C++ function within a call, the budget is shared
+        const bool outermost = !m_budget_running;
+        if (outermost) { start_budget(); }
+        install_budget_hook(pthread);
+
+        int status = lua_resume(pthread, nullptr, param_amount);
+
+        lua_sethook(pthread, nullptr, 0, 0);
+        if (outermost) { m_budget_running = false; }
+        return status;
+    }
+
+    void LuaStack::throw_resume_error(lua_State* pthread, int status) const
+    {
+        auto err_msg = get_value<std::string>(pthread, -1);
+        lua_settop(pthread, 0);
+        if (status == LUA_ERRMEM)
+        {
+            throw LuaMemoryError(err_msg);
+        }
+        if (status == LUA_ERRRUN && m_budget_exceeded)
+        {
+            throw LuaBudgetError(err_msg, m_exceeded_limit);
+        }
+        throw LuaError(err_msg, status);
+    }
+
+    void LuaStack::start_budget() const
+    {
+        m_budget_running = true;
+        m_budget_exceeded = false;
+        m_instructions_left = m_budget.max_instructions;
+        if (m_budget.timeout.count() != 0)
+        {
+            m_deadline = std::chrono::steady_clock::now() + m_budget.timeout;
+        }
+    }
+
+    void LuaStack::install_budget_hook(lua_State* plua) const
+    {
+        *static_cast<const LuaStack**>(lua_getextraspace(plua)) = this;
+        lua_sethook(plua, &budget_hook, LUA_MASKCOUNT, static_cast<int>(m_budget.check_every));
+    }
+
+    int LuaStack::traced_call(int param_amount, int return_amount, int err_handler) const
+    {
+        if (err_handler != 0 || m_traceback_mode == LuaTraceback::none)
+        {
+            return lua_pcall(m_plua, param_amount, return_amount, err_handler);
+        }
+
+        // A C function without upvalues is pushed without allocating.
+        const int handler = lua_gettop(m_plua) - param_amount;
+        lua_pushcfunction(m_plua, &message_handler);
+        lua_insert(m_plua, handler);
+        m_traceback.clear();
+        int status = lua_pcall(m_plua, param_amount, return_amount, handler);
+        lua_remove(m_plua, handler);
+        return status;
+    }
+
+    void LuaStack::budget_hook(lua_State* plua, lua_Debug*)
+    {
+        auto pstack = *static_cast<const LuaStack**>(lua_getextraspace(plua));
+        if (!pstack->m_budget_running)
+        {
+            // Coroutine created during an earlier call, resumed outside it
+            lua_sethook(plua, nullptr, 0, 0);
+            return;
+        }
+        if (!pstack->m_budget_exceeded)
+        {
+            const LuaBudget& budget = pstack->m_budget;
+            if (budget.max_instructions != 0)
+            {
+                if (pstack->m_instructions_left <= budget.check_every)
+                {
+                    pstack->m_budget_exceeded = true;
+                    pstack->m_exceeded_limit = LuaBudgetLimit::instructions;
+                }
+                else
+                {
+                    pstack->m_instructions_left -= budget.check_every;
+                }
+            }
+            if (!pstack->m_budget_exceeded && budget.timeout.count() != 0
+                && std::chrono::steady_clock::now() >= pstack->m_deadline)
+            {
+                pstack->m_budget_exceeded = true;
+                pstack->m_exceeded_limit = LuaBudgetLimit::deadline;
+            }
+            if (!pstack->m_budget_exceeded) { return; }
+
+            // Raise the error again right away if the script catches it
+            lua_sethook(plua, &budget_hook, LUA_MASKCOUNT, 1);
+        }
+
+        if (pstack->m_exceeded_limit == LuaBudgetLimit::instructions)
+        {
+            luaL_error(plua, "instruction budget exceeded");
+        }
+        else
+        {
+            luaL_error(plua, "deadline exceeded");
+        }
+    }
+
+    int LuaStack::message_handler(lua_State* plua)
+    {
+        lua_rawgetp(plua, LUA_REGISTRYINDEX, &TRACEBACK_KEY);
+        auto pstack = static_cast<const LuaStack*>(lua_touserdata(plua, -1));
+        lua_pop(plua, 1);
+        if (!pstack) { return 1; }
+
+        bool capture = pstack->m_traceback_mode == LuaTraceback::always
+                    || (pstack->m_traceback_mode == LuaTraceback::sampled
+                        && pstack->m_error_count++ % pstack->m_traceback_sample_every == 0);
+        if (capture)
+        {
+            luaL_traceback(plua, plua, nullptr, 1);
+            size_t length = 0;
+            const char* traceback = lua_tolstring(plua, -1, &length);
+            try
+            {
+                pstack->m_traceback.assign(traceback, length);
+            }
+            catch (const std::bad_alloc&)
+            {
+                // The error is reported without traceback
+            }
+            lua_pop(plua, 1);
+        }
+        return 1;  // The error message
+    }
+}
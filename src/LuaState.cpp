@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <cstdio>
 #include <stdexcept>
 #include <lua.hpp>
 #include <LuaStack.h>
@@ -7,8 +8,46 @@
 
 namespace lpp
 {
+    namespace
+    {
+        int panic(lua_State* plua)
+        {
+            const char* msg = lua_tostring(plua, -1);
+            std::fprintf(stderr, "PANIC: unprotected error in call to Lua API (%s)\n",
+                         msg ? msg : "error object is not a string");
+            return 0;  // Lua aborts afterwards
+        }
+
+        lua_State* new_lua_state(LuaAllocator* pallocator)
+        {
+            lua_State* plua = lua_newstate(&LuaAllocator::allocate, pallocator);
+            if (!plua) { throw LuaMemoryError("not enough memory"); }
+            lua_atpanic(plua, &panic);
+            return plua;
+        }
+    }
+
     LuaState::LuaState()
-        : m_pstack(std::make_shared<LuaStack>(luaL_newstate())) {}
+        : LuaState(LuaStateOptions()) {}
+
+    LuaState::LuaState(std::shared_ptr<LuaAllocator> pallocator)
+        : LuaState(LuaStateOptions{ std::move(pallocator) }) {}
+
+    LuaState::LuaState(const LuaStateOptions& options)
+        : m_pmemory(std::make_shared<LuaMemoryTracker>(options.pallocator))
+        , m_pstack(std::make_shared<LuaStack>(new_lua_state(m_pmemory.get()),
+                                              m_pmemory,
+                                              LuaLibs::none))
+    {
+        if (options.lazy_libs)
+        {
+            m_pstack->open_libs_lazily(options.libs);
+        }
+        else
+        {
+            m_pstack->open_libs(options.libs);
+        }
+    }
 
     LuaState::~LuaState() {}
 
@@ -22,16 +61,46 @@ namespace lpp
         m_pstack->run_file(script_path);
     }
 
+    void LuaState::prime_file(const std::string& script_path) const
+    {
+        m_pstack->prime_file(script_path);
+    }
+
     void LuaState::run_string(const std::string& script_code) const
     {
         m_pstack->run_string(script_code);
     }
 
+    void LuaState::set_bytecode_cache(std::shared_ptr<const LuaBytecodeCache> pcache) const
+    {
+        m_pstack->set_bytecode_cache(std::move(pcache));
+    }
+
+    void LuaState::set_traceback_mode(LuaTraceback mode, uint32_t sample_every) const
+    {
+        m_pstack->set_traceback_mode(mode, sample_every);
+    }
+
+    void LuaState::set_budget(const LuaBudget& budget) const
+    {
+        m_pstack->set_budget(budget);
+    }
+
     LuaFunctionBuilder LuaState::import_function_from(std::string&& file) const
     {
         return LuaFunctionBuilder(m_pstack, std::move(file));
     }
 
+    const LuaMemoryStats& LuaState::memory_stats() const
+    {
+        return m_pmemory->stats();
+    }
+
+    void LuaState::set_memory_limit(size_t max_bytes) const
+    {
+        m_pmemory->set_limit(max_bytes);
+    }
+
     const std::shared_ptr<LuaStack>& LuaState::get_stack() const
     {
         return m_pstack;
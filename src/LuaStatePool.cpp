@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <assert.h>
+#include <LuaStatePool.h>
+
+
+namespace lpp
+{
+    LuaStatePool::Handle::Handle(Handle&& other) noexcept
+        : m_ppool(other.m_ppool)
+        , m_pstate(other.m_pstate)
+    {
+        other.m_pstate = nullptr;
+    }
+
+    LuaStatePool::Handle& LuaStatePool::Handle::operator=(Handle&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            m_ppool = other.m_ppool;
+            m_pstate = other.m_pstate;
+            other.m_pstate = nullptr;
+        }
+        return *this;
+    }
+
+    LuaStatePool::Handle::~Handle()
+    {
+        release();
+    }
+
+    void LuaStatePool::Handle::release()
+    {
+        if (m_pstate == nullptr) { return; }
+        m_ppool->give_back(m_pstate);
+        m_pstate = nullptr;
+    }
+
+    LuaStatePool::LuaStatePool(LuaStatePoolOptions options)
+        : m_options(std::move(options))
+    {
+        m_states.reserve(m_options.size);
+        m_available.reserve(m_options.size);
+        for (size_t i = 0; i < m_options.size; ++i)
+        {
+            m_states.push_back(create_state());
+            m_available.push_back(m_states.back().get());
+        }
+        m_metrics.size = m_states.size();
+    }
+
+    LuaStatePool::~LuaStatePool()
+    {
+        assert(m_available.size() + m_lost_states == m_states.size()
+               && "All states should be returned before destroying the pool!");
+    }
+
+    LuaStatePool::Handle LuaStatePool::checkout()
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_state_returned.wait(lock, [this] { return can_take_state(); });
+        return Handle(this, take_or_create_state(lock, start));
+    }
+
+    LuaStatePool::Handle LuaStatePool::try_checkout(std::chrono::nanoseconds timeout)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_state_returned.wait_until(lock, start + timeout,
+                                         [this] { return can_take_state(); }))
+        {
+            ++m_metrics.timeouts;
+            return Handle();
+        }
+        return Handle(this, take_or_create_state(lock, start));
+    }
+
+    LuaStatePoolMetrics LuaStatePool::metrics() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_metrics;
+    }
+
+    std::unique_ptr<LuaState> LuaStatePool::create_state() const
+    {
+        auto pstate = std::make_unique<LuaState>(m_options.state_options);
+        if (m_options.init) { m_options.init(*pstate); }
+        return pstate;
+    }
+
+    bool LuaStatePool::can_take_state() const
+    {
+        // NOTE: called with the mutex locked.
+        return !m_available.empty() || m_lost_states > 0;
+    }
+
+    LuaState* LuaStatePool::take_or_create_state(std::unique_lock<std::mutex>& lock,
+                                                 std::chrono::steady_clock::time_point start)
+    {
+        if (!m_available.empty()) { return take_state(start); }
+
+        // Only slots of lost states are left, make a new state for one of
+        // them (without holding the lock, init can take a while).
+        --m_lost_states;
+        lock.unlock();
+        std::unique_ptr<LuaState> pfresh;
+        try
+        {
+            pfresh = create_state();
+        }
+        catch (...)
+        {
+            lock.lock();
+            ++m_lost_states;
+            m_state_returned.notify_one();
+            throw;
+        }
+
+        lock.lock();
+        auto it = std::find(m_states.begin(), m_states.end(), nullptr);
+        assert(it != m_states.end());
+        *it = std::move(pfresh);
+        m_available.push_back(it->get());
+        return take_state(start);
+    }
+
+    LuaState* LuaStatePool::take_state(std::chrono::steady_clock::time_point start)
+    {
+        // NOTE: called with the mutex locked.
+        LuaState* pstate = m_available.back();
+        m_available.pop_back();
+
+        auto waited = std::chrono::steady_clock::now() - start;
+        ++m_metrics.checkouts;
+        ++m_metrics.in_use;
+        m_metrics.peak_in_use = std::max(m_metrics.peak_in_use, m_metrics.in_use);
+        m_metrics.total_wait += waited;
+        m_metrics.max_wait = std::max<std::chrono::nanoseconds>(m_metrics.max_wait, waited);
+        return pstate;
+    }
+
+    void LuaStatePool::give_back(LuaState* pstate)
+    {
+        // Cleanup happens before taking the lock, only this thread uses the state.
+        try
+        {
+            if (m_options.reset) { m_options.reset(*pstate); }
+            if (m_options.gc_step_kb > 0)
+            {
+                pstate->get_stack()->gc_step(m_options.gc_step_kb);
+            }
+        }
+        catch (...)
+        {
+            // The state is in an unknown condition, replace it by a new one.
+            std::unique_ptr<LuaState> pfresh;
+            try { pfresh = create_state(); } catch (...) {}
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = std::find_if(m_states.begin(), m_states.end(),
+                                   [pstate](const auto& p) { return p.get() == pstate; });
+            --m_metrics.in_use;
+            if (pfresh)
+            {
+                *it = std::move(pfresh);
+                m_available.push_back(it->get());
+            }
+            else
+            {
+                it->reset();  // Made again on a later checkout
+                ++m_lost_states;
+            }
+            m_state_returned.notify_one();
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_available.push_back(pstate);
+        --m_metrics.in_use;
+        m_state_returned.notify_one();
+    }
+}
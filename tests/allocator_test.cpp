@@ -0,0 +1,79 @@
+#include <catch.hpp>
+#include <cstring>
+#include <LuaSlabAllocator.h>
+#include <LuaState.h>
+
+
+using lpp::LuaState;
+using lpp::LuaSlabAllocator;
+
+
+SCENARIO ("Using the slab allocator")
+{
+    GIVEN ("A slab allocator")
+    {
+        LuaSlabAllocator allocator;
+
+        WHEN ("a small block is resized within its size class")
+        {
+            auto p1 = allocator.reallocate(nullptr, 0, 20);
+            auto p2 = allocator.reallocate(p1, 20, 24);
+
+            THEN ("the same block is reused.")
+            {
+                REQUIRE (p1 != nullptr);
+                REQUIRE (p1 == p2);
+            }
+            allocator.reallocate(p2, 24, 0);
+        }
+
+        AND_WHEN ("blocks are resized across size classes")
+        {
+            auto p = static_cast<char*>(allocator.reallocate(nullptr, 0, 16));
+            std::memcpy(p, "0123456789abcde", 16);
+            p = static_cast<char*>(allocator.reallocate(p, 16, 100));
+            p = static_cast<char*>(allocator.reallocate(p, 100, 4096));
+            p = static_cast<char*>(allocator.reallocate(p, 4096, 16));
+
+            THEN ("the contents are preserved.")
+            {
+                REQUIRE (std::string(p) == "0123456789abcde");
+            }
+            allocator.reallocate(p, 16, 0);
+        }
+
+        AND_WHEN ("a block is freed")
+        {
+            auto p1 = allocator.reallocate(nullptr, 0, 64);
+            allocator.reallocate(p1, 64, 0);
+            auto p2 = allocator.reallocate(nullptr, 0, 64);
+
+            THEN ("it is reused for the next allocation of the same size.")
+            {
+                REQUIRE (p1 == p2);
+            }
+            allocator.reallocate(p2, 64, 0);
+        }
+    }
+
+    GIVEN ("A LuaState using the slab allocator")
+    {
+        LuaState lua(std::make_shared<LuaSlabAllocator>());
+
+        WHEN ("a script allocating many tables and strings is ran")
+        {
+            lua.run_file("tests/allocator_test.lua");
+            auto s = lua.get_stack();
+            s->get_global("total");
+            s->get_global("last_name");
+            auto total = s->get<uint32_t>(-2);
+            auto last_name = s->get<std::string>(-1);
+
+            THEN ("the script behaves the same as with the default allocator.")
+            {
+                REQUIRE (total == 500500);
+                REQUIRE (last_name == "item1000");
+            }
+        }
+    }
+}
@@ -0,0 +1,10 @@
+local parts = {}
+for i = 1, 1000 do
+    parts[i] = { index = i, name = "item" .. i }
+end
+
+total = 0
+for _, part in ipairs(parts) do
+    total = total + part.index
+end
+last_name = parts[#parts].name
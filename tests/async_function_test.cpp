@@ -0,0 +1,199 @@
+#include <catch.hpp>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <LuaState.h>
+#include <LuaScheduler.h>
+#include "coroutine_task.hpp"
+
+
+using lpp::LuaState;
+using lpp::LuaScheduler;
+using namespace std::chrono_literals;
+
+
+namespace
+{
+    constexpr auto LATENCY = 50ms;
+
+    /**
+     * Stand-in for a remote cache, every lookup takes LATENCY.
+     */
+    std::future<std::string> lookup(std::string key)
+    {
+        return std::async(std::launch::async, [key] {
+            std::this_thread::sleep_for(LATENCY);
+            if (key == "missing") { throw std::runtime_error("no value for " + key); }
+            return "value of " + key;
+        });
+    }
+
+#ifdef LPP_HAS_COROUTINES
+    /**
+     * Awaits 'fetch' for every key, errors are stored as values.
+     */
+    Task fetch_all(LuaScheduler& scheduler,
+                   lpp::LuaCoroutine<std::string, std::string>& fetch,
+                   std::vector<std::string> keys,
+                   std::vector<std::string>& values)
+    {
+        for (const auto& key : keys)
+        {
+            try
+            {
+                values.push_back(co_await scheduler.resume(fetch, key));
+            }
+            catch (const lpp::LuaError& e)
+            {
+                values.push_back(std::string("error: ") + e.what());
+            }
+        }
+    }
+#endif
+}
+
+
+SCENARIO ("Calling async C++ functions from Lua")
+{
+    GIVEN ("A Lua state with an async C++ function")
+    {
+        LuaState lua;
+        lua.export_async_function(&lookup, "lookup");
+        lua.run_file("tests/async_function_test.lua");
+
+        WHEN ("many coroutines call it on one scheduler")
+        {
+            LuaScheduler scheduler;
+            std::vector<std::future<std::string>> results;
+            for (int i = 0; i < 8; ++i)
+            {
+                results.push_back(scheduler.spawn(
+                    lua.make_coroutine<std::string, std::string>("fetch"),
+                    std::string("key") + std::to_string(i)));
+            }
+            REQUIRE (scheduler.size() == 8);
+            scheduler.poll();
+
+            THEN ("all of them are suspended on their call until the results are available")
+            {
+                REQUIRE (scheduler.size() == 8);
+                scheduler.run();
+                REQUIRE (scheduler.size() == 0);
+                for (int i = 0; i < 8; ++i)
+                {
+                    REQUIRE (results[i].get() == "value of key" + std::to_string(i));
+                }
+            }
+        }
+
+        WHEN ("a coroutine calls it several times or yields itself")
+        {
+            LuaScheduler scheduler;
+            auto pair = scheduler.spawn(lua.make_coroutine<std::string, std::string,
+                                                           std::string>("fetch_pair"),
+                                        std::string("a"), std::string("b"));
+            auto after_yield = scheduler.spawn(lua.make_coroutine<std::string, std::string>(
+                                                   "fetch_after_yield"),
+                                               std::string("c"));
+            scheduler.run();
+
+            THEN ("it is resumed with each result")
+            {
+                REQUIRE (pair.get() == "value of a,value of b");
+                REQUIRE (after_yield.get() == "value of c");
+            }
+        }
+
+        WHEN ("the async work fails")
+        {
+            LuaScheduler scheduler;
+            auto unchecked = scheduler.spawn(lua.make_coroutine<std::string, std::string>("fetch"),
+                                             std::string("missing"));
+            auto checked = scheduler.spawn(lua.make_coroutine<std::string, std::string>(
+                                               "fetch_checked"),
+                                           std::string("missing"));
+            scheduler.run();
+
+            THEN ("the error is raised in the coroutine")
+            {
+                REQUIRE_THROWS (unchecked.get());
+                REQUIRE (checked.get() == "failed: no value for missing");
+            }
+        }
+
+        WHEN ("it is called from a coroutine created in Lua")
+        {
+            LuaScheduler scheduler;
+            auto wrapped = scheduler.spawn(lua.make_coroutine<std::string, std::string>(
+                                               "fetch_wrapped"),
+                                           std::string("w"));
+            scheduler.run();
+
+            THEN ("the result is waited for instead of yielding to the script")
+            {
+                REQUIRE (wrapped.get() == "value of w");
+            }
+        }
+
+#ifdef LPP_HAS_COROUTINES
+        WHEN ("C++ coroutines await Lua coroutines calling it")
+        {
+            LuaScheduler scheduler;
+            auto first = lua.make_coroutine<std::string, std::string>("fetch");
+            auto second = lua.make_coroutine<std::string, std::string>("fetch_checked");
+            std::vector<std::string> first_values;
+            std::vector<std::string> second_values;
+            fetch_all(scheduler, first, { "a" }, first_values);
+            fetch_all(scheduler, second, { "b" }, second_values);
+
+            THEN ("they are suspended until the results are available")
+            {
+                REQUIRE (first_values.empty());
+                REQUIRE (second_values.empty());
+                REQUIRE (scheduler.size() == 2);
+
+                scheduler.run();
+                REQUIRE (first_values == std::vector<std::string>{ "value of a" });
+                REQUIRE (second_values == std::vector<std::string>{ "value of b" });
+            }
+        }
+
+        WHEN ("an awaited call fails")
+        {
+            LuaScheduler scheduler;
+            auto fetch = lua.make_coroutine<std::string, std::string>("fetch");
+            std::vector<std::string> values;
+            fetch_all(scheduler, fetch, { "missing", "x" }, values);
+            scheduler.run();
+
+            THEN ("the error is raised in the awaiting coroutine")
+            {
+                REQUIRE (values.size() == 2);
+                REQUIRE (values[0].find("no value for missing") != std::string::npos);
+                REQUIRE (values[1].find("cannot resume dead coroutine") != std::string::npos);
+                REQUIRE (fetch.is_finished());
+            }
+        }
+#endif
+
+        WHEN ("it is called outside of a scheduler")
+        {
+            auto fetch = lua.import_function_from("tests/async_function_test.lua")
+                            .with_name("fetch")
+                            .with_return_type<std::string>()
+                            .with_params<std::string>()
+                            .build();
+            auto coroutine = fetch.make_coroutine();
+
+            THEN ("the result is waited for")
+            {
+                REQUIRE (fetch("x") == "value of x");
+                REQUIRE (coroutine.resume("y") == "value of y");
+                REQUIRE (coroutine.is_finished());
+            }
+        }
+    }
+}
@@ -0,0 +1,23 @@
+
+function fetch(key)
+    return lookup(key)
+end
+
+function fetch_pair(first, second)
+    return lookup(first) .. "," .. lookup(second)
+end
+
+function fetch_checked(key)
+    local ok, err = pcall(lookup, key)
+    if ok then return err end
+    return "failed: " .. err
+end
+
+function fetch_after_yield(key)
+    coroutine.yield()
+    return lookup(key)
+end
+
+function fetch_wrapped(key)
+    return coroutine.wrap(function() return lookup(key) end)()
+end
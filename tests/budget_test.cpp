@@ -0,0 +1,119 @@
+#include <catch.hpp>
+#include <chrono>
+#include <string>
+#include <LuaState.h>
+#include <LuaFunction.hpp>
+#include <LuaScheduler.h>
+
+
+using lpp::LuaState;
+using lpp::LuaBudget;
+using lpp::LuaBudgetError;
+using lpp::LuaBudgetLimit;
+using lpp::LuaScheduler;
+using namespace std::chrono_literals;
+
+
+SCENARIO ("Limiting the budget of Lua calls")
+{
+    GIVEN ("A Lua state running scripts that do not finish")
+    {
+        LuaState lua;
+        lua.run_file("tests/budget_test.lua");
+        auto sum = lua.import_function_from("tests/budget_test.lua")
+                      .with_name("sum")
+                      .with_return_type<int64_t>()
+                      .with_params<int64_t>()
+                      .build();
+
+        WHEN ("the instructions are limited")
+        {
+            LuaBudget budget;
+            budget.max_instructions = 100000;
+            budget.check_every = 100;
+            lua.set_budget(budget);
+
+            THEN ("calls going over it are aborted with a budget error")
+            {
+                try
+                {
+                    lua.run_string("spin()");
+                    REQUIRE ((false && "unreachable code!"));
+                }
+                catch (LuaBudgetError& e)
+                {
+                    REQUIRE (e.limit() == LuaBudgetLimit::instructions);
+                    REQUIRE (std::string(e.what()).find("instruction budget exceeded")
+                             != std::string::npos);
+                }
+            }
+            THEN ("catching the error in Lua does not help")
+            {
+                REQUIRE_THROWS_AS(lua.run_string("spin_catching()"), LuaBudgetError&);
+                REQUIRE_THROWS_AS(lua.run_string("spin_in_coroutine()"), LuaBudgetError&);
+            }
+            THEN ("coroutines resumed from C++ are aborted as well")
+            {
+                auto spin = lua.make_coroutine<void>("spin");
+                REQUIRE_THROWS_AS(spin.resume(), LuaBudgetError&);
+                REQUIRE (spin.is_finished());
+
+                LuaScheduler scheduler;
+                auto result = scheduler.spawn(lua.make_coroutine<void>("spin"));
+                scheduler.run();
+                REQUIRE_THROWS_AS(result.get(), LuaBudgetError&);
+                REQUIRE (sum(1000) == 500500);
+            }
+            THEN ("every call gets the full budget")
+            {
+                for (int i = 0; i < 10; ++i)
+                {
+                    REQUIRE (sum(1000) == 500500);
+                }
+                REQUIRE_THROWS_AS(sum(1000000), LuaBudgetError&);
+                REQUIRE (sum(1000) == 500500);
+            }
+        }
+
+        WHEN ("the wall-clock time is limited")
+        {
+            LuaBudget budget;
+            budget.timeout = 50ms;
+            lua.set_budget(budget);
+
+            auto start = std::chrono::steady_clock::now();
+            LuaBudgetLimit limit = LuaBudgetLimit::instructions;
+            try
+            {
+                lua.run_string("spin()");
+            }
+            catch (LuaBudgetError& e)
+            {
+                limit = e.limit();
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+
+            THEN ("calls are aborted once the deadline passed")
+            {
+                REQUIRE (limit == LuaBudgetLimit::deadline);
+                REQUIRE (elapsed >= 50ms);
+                REQUIRE (elapsed < 1s);
+                REQUIRE (sum(10) == 55);
+            }
+        }
+
+        WHEN ("the budget is removed again")
+        {
+            LuaBudget budget;
+            budget.max_instructions = 1000;
+            lua.set_budget(budget);
+            REQUIRE_THROWS_AS(sum(100000), LuaBudgetError&);
+            lua.set_budget(LuaBudget());
+
+            THEN ("calls run unbounded")
+            {
+                REQUIRE (sum(100000) == 5000050000);
+            }
+        }
+    }
+}
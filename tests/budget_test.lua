@@ -0,0 +1,22 @@
+
+function spin()
+    while true do end
+end
+
+function spin_catching()
+    while true do
+        pcall(spin)
+    end
+end
+
+function spin_in_coroutine()
+    local co = coroutine.create(spin)
+    coroutine.resume(co)
+    while true do end
+end
+
+function sum(n)
+    local total = 0
+    for i = 1, n do total = total + i end
+    return total
+end
@@ -0,0 +1,133 @@
+#include <catch.hpp>
+#include <filesystem>
+#include <fstream>
+#include <LuaState.h>
+
+
+using lpp::LuaState;
+using lpp::LuaBytecodeCache;
+namespace fs = std::filesystem;
+
+
+static std::vector<fs::path> cache_entries(const fs::path& dir)
+{
+    std::vector<fs::path> entries;
+    for (const auto& entry : fs::directory_iterator(dir))
+    {
+        entries.push_back(entry.path());
+    }
+    return entries;
+}
+
+static uint32_t run_cached(const std::shared_ptr<LuaBytecodeCache>& cache)
+{
+    LuaState lua;
+    lua.set_bytecode_cache(cache);
+    lua.run_file("tests/lua_state_test.lua");
+    auto s = lua.get_stack();
+    s->get_global("x");
+    return s->get<uint32_t>(-1);
+}
+
+
+SCENARIO ("Loading scripts through a bytecode cache")
+{
+    GIVEN ("An empty bytecode cache directory")
+    {
+        auto dir = fs::temp_directory_path() / "lpp_bytecode_cache_test";
+        fs::remove_all(dir);
+        auto cache = std::make_shared<LuaBytecodeCache>(dir.string());
+
+        WHEN ("a script is ran multiple times")
+        {
+            auto x1 = run_cached(cache);
+            auto x2 = run_cached(cache);
+
+            THEN ("it is compiled once and loaded from the cache afterwards.")
+            {
+                REQUIRE (x1 == 0xb7a121);
+                REQUIRE (x2 == 0xb7a121);
+                REQUIRE (cache_entries(dir).size() == 1);
+            }
+        }
+
+        AND_WHEN ("a cache entry is corrupt")
+        {
+            run_cached(cache);
+            auto entry = cache_entries(dir).at(0);
+            {
+                std::ofstream file(entry, std::ios::binary | std::ios::trunc);
+                file << "garbage";
+            }
+            auto x = run_cached(cache);
+
+            THEN ("the entry is rejected and replaced.")
+            {
+                REQUIRE (x == 0xb7a121);
+                REQUIRE (fs::file_size(entry) > std::string("garbage").size());
+            }
+        }
+
+        AND_WHEN ("debug info is stripped")
+        {
+            auto stripped = std::make_shared<LuaBytecodeCache>(dir.string(), true);
+            auto x1 = run_cached(stripped);
+            auto x2 = run_cached(stripped);
+
+            THEN ("the stripped chunks can be loaded as well.")
+            {
+                REQUIRE (x1 == 0xb7a121);
+                REQUIRE (x2 == 0xb7a121);
+            }
+        }
+
+        AND_WHEN ("two scripts have the same content")
+        {
+            auto scripts = fs::temp_directory_path() / "lpp_bytecode_cache_scripts";
+            fs::create_directories(scripts);
+            std::vector<std::string> errors;
+            for (auto name : { "first.lua", "second.lua" })
+            {
+                auto path = (scripts / name).string();
+                std::ofstream(path) << "error('failed')";
+                try
+                {
+                    LuaState lua;
+                    lua.set_bytecode_cache(cache);
+                    lua.run_file(path);
+                }
+                catch (lpp::LuaError& e)
+                {
+                    errors.push_back(e.what());
+                }
+            }
+            fs::remove_all(scripts);
+
+            THEN ("errors report the name of the script that raised them.")
+            {
+                REQUIRE (errors.size() == 2);
+                REQUIRE (errors[0].find("first.lua") != std::string::npos);
+                REQUIRE (errors[1].find("second.lua") != std::string::npos);
+                REQUIRE (cache_entries(dir).size() == 2);
+            }
+        }
+
+        AND_WHEN ("a non-existing script is loaded")
+        {
+            THEN ("the same error as without cache should be raised.")
+            {
+                try
+                {
+                    LuaState lua;
+                    lua.set_bytecode_cache(cache);
+                    lua.run_file("incorrect.lua");
+                    REQUIRE ((false && "unreachable code!"));
+                }
+                catch (lpp::LuaError& e)
+                {
+                    REQUIRE (std::string(e.what()) == "cannot open incorrect.lua: No such file or directory");
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,9 @@
+times_loaded = (times_loaded or 0) + 1
+
+function first()
+    return 1
+end
+
+function second()
+    return 2
+end
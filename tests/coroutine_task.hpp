@@ -0,0 +1,21 @@
+#pragma once
+#include <LuaCoroutine.hpp>
+
+
+#ifdef LPP_HAS_COROUTINES
+/**
+ * Minimal C++20 coroutine type for the tests, runs eagerly until its first
+ * suspension.
+ */
+struct Task
+{
+    struct promise_type
+    {
+        Task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { throw; }
+    };
+};
+#endif
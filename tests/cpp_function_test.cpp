@@ -1,5 +1,7 @@
 #include <LuaState.h>
 #include <catch.hpp>
+#include <functional>
+#include <memory>
 #include <sstream>
 
 
@@ -9,11 +11,61 @@ using lpp::LuaFunction;
 static const std::string ERROR_MSG = "an example error msg";
 
 
+struct Event
+{
+    std::string name;
+    int32_t priority;
+    std::vector<std::string> tags;
+};
+
+struct Blob
+{
+    static int alive;
+
+    std::string data;
+
+    Blob() { ++alive; }
+    Blob(const Blob& other) : data(other.data) { ++alive; }
+    ~Blob() { --alive; }
+};
+
+int Blob::alive = 0;
+
+namespace lpp
+{
+    template <>
+    struct LuaStruct<Event>
+    {
+        static constexpr auto fields = std::make_tuple(
+            lua_field("name", &Event::name),
+            lua_field("priority", &Event::priority),
+            lua_field("tags", &Event::tags));
+    };
+
+    template <>
+    struct LuaStruct<Blob>
+    {
+        static constexpr auto fields = std::make_tuple(lua_field("data", &Blob::data));
+    };
+}
+
+
 int32_t add(int32_t x, int32_t y);
 std::string multiply_string(std::string str, uint8_t count);
 int bad_function(int);
 void void_function();
 int identity(int);
+size_t length(std::string_view str);
+std::string echo(std::string str);
+bool is_hello(const char* str);
+std::tuple<int32_t, int32_t> divmod(int32_t x, int32_t y);
+std::pair<std::string, bool> describe(int32_t x);
+int64_t sum_all(std::vector<int64_t> values);
+std::map<std::string, int32_t> word_counts(std::vector<std::string> words);
+std::vector<std::vector<int32_t>> transpose(std::vector<std::vector<int32_t>> matrix);
+std::array<double, 3> scale(std::array<double, 3> v, double factor);
+Event escalate(Event event);
+Blob make_blob(size_t size);
 
 
 int32_t add(int32_t x, int32_t y)
@@ -39,6 +91,71 @@ void void_function() {}
 
 int identity(int x) { return x; }
 
+size_t length(std::string_view str) { return str.length(); }
+
+std::string echo(std::string str) { return str; }
+
+bool is_hello(const char* str) { return std::string(str) == "hello"; }
+
+std::tuple<int32_t, int32_t> divmod(int32_t x, int32_t y)
+{
+    return std::make_tuple(x / y, x % y);
+}
+
+std::pair<std::string, bool> describe(int32_t x)
+{
+    return std::make_pair(std::to_string(x), x % 2 == 0);
+}
+
+int64_t sum_all(std::vector<int64_t> values)
+{
+    int64_t sum = 0;
+    for (auto value : values) { sum += value; }
+    return sum;
+}
+
+std::map<std::string, int32_t> word_counts(std::vector<std::string> words)
+{
+    std::map<std::string, int32_t> counts;
+    for (const auto& word : words) { ++counts[word]; }
+    return counts;
+}
+
+std::vector<std::vector<int32_t>> transpose(std::vector<std::vector<int32_t>> matrix)
+{
+    std::vector<std::vector<int32_t>> result;
+    if (matrix.empty()) { return result; }
+    result.resize(matrix[0].size(), std::vector<int32_t>(matrix.size()));
+    for (size_t i = 0; i < matrix.size(); ++i)
+    {
+        for (size_t j = 0; j < matrix[i].size() && j < result.size(); ++j)
+        {
+            result[j][i] = matrix[i][j];
+        }
+    }
+    return result;
+}
+
+std::array<double, 3> scale(std::array<double, 3> v, double factor)
+{
+    for (auto& x : v) { x *= factor; }
+    return v;
+}
+
+Event escalate(Event event)
+{
+    event.priority += 10;
+    event.tags.push_back("escalated");
+    return event;
+}
+
+Blob make_blob(size_t size)
+{
+    Blob blob;
+    blob.data.assign(size, 'x');
+    return blob;
+}
+
 
 SCENARIO ("Importing C++ functions into Lua")
 {
@@ -95,4 +212,395 @@ SCENARIO ("Importing C++ functions into Lua")
     }
 }
 
-//TODO multiple return types... ; lambda / function pointer
+SCENARIO ("Passing strings between C++ and Lua")
+{
+    GIVEN ("Exported C++ functions taking strings")
+    {
+        LuaState lua;
+        lua.export_function(length, "length");
+        lua.export_function(echo, "echo");
+        lua.export_function(is_hello, "is_hello");
+
+        WHEN ("they are called with strings containing NUL characters")
+        {
+            lua.run_string("len = length('a\\0b\\0c') "
+                           "echoed = #echo('a\\0b') "
+                           "hello = is_hello('hello')");
+
+            THEN ("the full strings are passed, without truncation.")
+            {
+                auto s = lua.get_stack();
+                s->get_global("len");
+                s->get_global("echoed");
+                s->get_global("hello");
+                REQUIRE (s->get<size_t>(-3) == 5);
+                REQUIRE (s->get<size_t>(-2) == 3);
+                REQUIRE (s->get<bool>(-1) == true);
+                s->pop(3);
+            }
+        }
+
+        AND_WHEN ("a string view is read from the stack")
+        {
+            auto s = lua.get_stack();
+            s->push(std::string_view("x\0y", 3));
+            auto view = s->get<std::string_view>(-1);
+
+            THEN ("it covers the full string in Lua memory.")
+            {
+                REQUIRE (view == std::string_view("x\0y", 3));
+                s->pop(1);
+            }
+        }
+    }
+}
+
+SCENARIO ("Returning multiple values from C++ to Lua")
+{
+    GIVEN ("Exported C++ functions returning tuples and pairs")
+    {
+        LuaState lua;
+        lua.export_function(divmod, "divmod");
+        lua.export_function(describe, "describe");
+
+        WHEN ("they are called in Lua")
+        {
+            lua.run_string("q, r = divmod(17, 5) "
+                           "str, even = describe(42)");
+
+            THEN ("every element is returned as a separate value.")
+            {
+                auto s = lua.get_stack();
+                s->get_global("q");
+                s->get_global("r");
+                s->get_global("str");
+                s->get_global("even");
+                REQUIRE (s->get<int32_t>(-4) == 3);
+                REQUIRE (s->get<int32_t>(-3) == 2);
+                REQUIRE (s->get<std::string>(-2) == "42");
+                REQUIRE (s->get<bool>(-1) == true);
+                s->pop(4);
+            }
+        }
+    }
+}
+
+SCENARIO ("Passing containers between C++ and Lua")
+{
+    GIVEN ("Exported C++ functions taking and returning containers")
+    {
+        LuaState lua;
+        lua.export_function(sum_all, "sum_all");
+        lua.export_function(word_counts, "word_counts");
+        lua.export_function(transpose, "transpose");
+        lua.export_function(scale, "scale");
+
+        WHEN ("they are called with Lua tables")
+        {
+            lua.run_string("sum = sum_all({ 1, 2, 3, 4 }) "
+                           "counts = word_counts({ 'a', 'b', 'a' }) "
+                           "t = transpose({ { 1, 2, 3 }, { 4, 5, 6 } }) "
+                           "v = scale({ 1, 2, 3 }, 0.5)");
+
+            THEN ("sequences and maps are converted in both directions.")
+            {
+                auto s = lua.get_stack();
+                s->get_global("sum");
+                s->get_global("counts");
+                s->get_global("t");
+                s->get_global("v");
+                REQUIRE (s->get<int64_t>(-4) == 10);
+                auto counts = s->get<std::map<std::string, int32_t>>(-3);
+                REQUIRE (counts.size() == 2);
+                REQUIRE (counts["a"] == 2);
+                REQUIRE (counts["b"] == 1);
+                auto t = s->get<std::vector<std::vector<int32_t>>>(-2);
+                REQUIRE ((t == std::vector<std::vector<int32_t>>({ { 1, 4 }, { 2, 5 }, { 3, 6 } })));
+                auto v = s->get<std::array<double, 3>>(-1);
+                REQUIRE ((v == std::array<double, 3>{ { 0.5, 1.0, 1.5 } }));
+                s->pop(4);
+            }
+        }
+
+        AND_WHEN ("a map with numeric keys is read as a map with string keys")
+        {
+            auto s = lua.get_stack();
+            s->push(std::unordered_map<int32_t, std::string>({ { 1, "one" }, { 2, "two" } }));
+            auto names = s->get<std::unordered_map<std::string, std::string>>(-1);
+            auto values = s->get<std::vector<std::string>>(-1);
+
+            THEN ("the keys in the Lua table are left untouched.")
+            {
+                REQUIRE (names.size() == 2);
+                REQUIRE (names["1"] == "one");
+                REQUIRE (names["2"] == "two");
+                REQUIRE (values == std::vector<std::string>({ "one", "two" }));
+                s->pop(1);
+            }
+        }
+    }
+}
+
+SCENARIO ("Passing structs between C++ and Lua")
+{
+    GIVEN ("An exported C++ function taking and returning a struct")
+    {
+        LuaState lua;
+        lua.export_function(escalate, "escalate");
+
+        WHEN ("it is called with a Lua table")
+        {
+            lua.run_string("e = escalate({ name = 'disk full', priority = 1, tags = { 'io' } }) "
+                           "partial = escalate({ name = 'no priority' })");
+
+            THEN ("the fields are converted in both directions.")
+            {
+                auto s = lua.get_stack();
+                s->get_global("e");
+                s->get_global("partial");
+                Event e = s->get<Event>(-2);
+                Event partial = s->get<Event>(-1);
+                REQUIRE (e.name == "disk full");
+                REQUIRE (e.priority == 11);
+                REQUIRE (e.tags == std::vector<std::string>({ "io", "escalated" }));
+                REQUIRE (partial.name == "no priority");
+                REQUIRE (partial.priority == 10);
+                s->pop(2);
+            }
+        }
+    }
+
+    GIVEN ("An exported C++ function returning a struct that is too large to push")
+    {
+        LuaState lua;
+        lua.export_function(make_blob, "make_blob");
+        lua.set_memory_limit(lua.memory_stats().current_bytes + 64 * 1024);
+
+        WHEN ("it is called")
+        {
+            lua.run_string("ok, err = pcall(make_blob, 1024 * 1024)");
+
+            THEN ("a memory error is raised and the result is destroyed.")
+            {
+                auto s = lua.get_stack();
+                s->get_global("ok");
+                s->get_global("err");
+                REQUIRE (s->get<bool>(-2) == false);
+                REQUIRE (s->get<std::string>(-1) == "not enough memory");
+                REQUIRE (Blob::alive == 0);
+                s->pop(2);
+            }
+        }
+    }
+}
+
+SCENARIO ("Importing C++ functions known at compile time into Lua")
+{
+    GIVEN ("C++ functions exported as template parameter")
+    {
+        LuaState lua;
+        lua.export_function<&add>("add");
+        lua.export_function<&void_function>("void_function");
+        lua.export_function<&divmod>("divmod");
+        lua.export_function<&bad_function>("bad_function");
+
+        WHEN ("they are called in Lua")
+        {
+            lua.run_string("void_function() "
+                           "sum = add(40, 2) "
+                           "q, r = divmod(7, 2) "
+                           "ok, err = pcall(bad_function, 1)");
+
+            THEN ("they behave like functions exported at runtime.")
+            {
+                auto s = lua.get_stack();
+                s->get_global("sum");
+                s->get_global("q");
+                s->get_global("r");
+                s->get_global("ok");
+                s->get_global("err");
+                REQUIRE (s->get<int32_t>(-5) == 42);
+                REQUIRE (s->get<int32_t>(-4) == 3);
+                REQUIRE (s->get<int32_t>(-3) == 1);
+                REQUIRE (s->get<bool>(-2) == false);
+                REQUIRE (s->get<std::string>(-1) == ERROR_MSG);
+                s->pop(5);
+            }
+        }
+    }
+}
+
+SCENARIO ("Checking the arguments of exported C++ functions")
+{
+    GIVEN ("C++ functions exported with different argument policies")
+    {
+        LuaState lua;
+        lua.export_function(add, "lenient_add");
+        lua.export_function<lpp::LuaArgPolicy::strict>(add, "add");
+        lua.export_function<lpp::LuaArgPolicy::strict>(multiply_string, "multiply_string");
+        lua.export_function<&add, lpp::LuaArgPolicy::unchecked>("unchecked_add");
+        lua.export_function<lpp::LuaArgPolicy::strict>(
+            [](std::vector<int64_t> values) { return sum_all(values); }, "sum_all");
+        lua.export_function<lpp::LuaArgPolicy::strict>(
+            [](uint64_t size) { return size; }, "checked_size");
+        lua.export_function<lpp::LuaArgPolicy::strict>(
+            [](lpp::LuaBuffer<double> values) { return values.size(); }, "buffer_size");
+        lua.export_function<lpp::LuaArgPolicy::strict>(word_counts, "word_counts");
+
+        auto error_of = [&lua](const std::string& code) {
+            lua.run_string("ok, err = pcall(function() " + code + " end)");
+            auto s = lua.get_stack();
+            s->get_global("err");
+            auto err = s->get<std::string>(-1);
+            s->pop(1);
+            return err;
+        };
+
+        WHEN ("they are called with the right arguments")
+        {
+            lua.run_string("x = add(1, 2) "
+                           "y = unchecked_add(3, 4) "
+                           "z = lenient_add(nil, 5) "
+                           "str = multiply_string('ab', 2) "
+                           "sum = sum_all({ 1, 2, 3 })");
+
+            THEN ("they return their results.")
+            {
+                auto s = lua.get_stack();
+                s->get_global("x");
+                s->get_global("y");
+                s->get_global("z");
+                s->get_global("str");
+                s->get_global("sum");
+                REQUIRE (s->get<int32_t>(-5) == 3);
+                REQUIRE (s->get<int32_t>(-4) == 7);
+                REQUIRE (s->get<int32_t>(-3) == 5);
+                REQUIRE (s->get<std::string>(-2) == "abab");
+                REQUIRE (s->get<int64_t>(-1) == 6);
+                s->pop(5);
+            }
+        }
+
+        AND_WHEN ("strict functions are called with the wrong arguments")
+        {
+            THEN ("an error describing the bad argument is raised.")
+            {
+                REQUIRE (error_of("add(1)")
+                         == "wrong number of arguments to 'add' (expected 2, got 1)");
+                REQUIRE (error_of("add(1, 2, 3)")
+                         == "wrong number of arguments to 'add' (expected 2, got 3)");
+                REQUIRE (error_of("add(nil, 2)")
+                         == "bad argument #1 to 'add' (number expected, got nil)");
+                REQUIRE (error_of("add(1, 2.5)")
+                         == "bad argument #2 to 'add' (number has no integer representation)");
+                REQUIRE (error_of("add(1, 2^40)")
+                         == "bad argument #2 to 'add' (integer overflow: 1099511627776 "
+                            "does not fit in the requested type)");
+                REQUIRE (error_of("checked_size(-1)")
+                         == "bad argument #1 to 'checked_size' (integer overflow: -1 "
+                            "does not fit in the requested type)");
+                REQUIRE (error_of("multiply_string(1, 2)")
+                         == "bad argument #1 to 'multiply_string' (string expected, got number)");
+                REQUIRE (error_of("sum_all('x')")
+                         == "bad argument #1 to 'sum_all' (table expected, got string)");
+                REQUIRE (error_of("sum_all({ 'a', {} })")
+                         == "bad argument #1 to 'sum_all' (element 1: number expected, got string)");
+                REQUIRE (error_of("sum_all({ 1, 2.5 })")
+                         == "bad argument #1 to 'sum_all' (element 2: number has no integer "
+                            "representation)");
+                REQUIRE (error_of("word_counts({ 'a', 1 })")
+                         == "bad argument #1 to 'word_counts' (element 2: string expected, "
+                            "got number)");
+                REQUIRE (error_of("buffer_size({ 1.0 })")
+                         == "bad argument #1 to 'buffer_size' (buffer expected, got table)");
+            }
+        }
+    }
+}
+
+SCENARIO ("Forwarding C++ exceptions to Lua")
+{
+    GIVEN ("Exported C++ functions that throw")
+    {
+        LuaState lua;
+        lua.export_function(bad_function, "bad_function");
+        lua.export_function([](std::string str) -> std::string { throw std::runtime_error(str); },
+                            "throw_string");
+        lua.export_function([]() -> int32_t { throw 42; }, "throw_int");
+        lua.export_function([](int32_t x) noexcept { return x + 1; }, "increment");
+
+        WHEN ("they are called in protected mode")
+        {
+            lua.run_string("ok1, err1 = pcall(bad_function, 1) "
+                           "ok2, err2 = pcall(throw_string, 'custom error') "
+                           "ok3, err3 = pcall(throw_int) "
+                           "x = increment(41)");
+
+            THEN ("each exception becomes an error in Lua.")
+            {
+                auto s = lua.get_stack();
+                s->get_global("ok1");
+                s->get_global("err1");
+                s->get_global("err2");
+                s->get_global("err3");
+                s->get_global("x");
+                REQUIRE (s->get<bool>(-5) == false);
+                REQUIRE (s->get<std::string>(-4) == ERROR_MSG);
+                REQUIRE (s->get<std::string>(-3) == "custom error");
+                REQUIRE (s->get<std::string>(-2) == "unknown C++ exception");
+                REQUIRE (s->get<int32_t>(-1) == 42);
+                s->pop(5);
+            }
+        }
+    }
+}
+
+SCENARIO ("Importing lambdas and functors into Lua")
+{
+    GIVEN ("Exported callables with and without captured state")
+    {
+        auto tenant = std::make_shared<std::string>("tenant-a");
+
+        {
+            LuaState lua;
+            lua.export_function([](int32_t x) { return x * 2; }, "twice");
+            lua.export_function([tenant](std::string key) { return *tenant + "/" + key; },
+                                "tenant_key");
+            lua.export_function([count = 0]() mutable { return ++count; }, "next_id");
+            std::function<int32_t(int32_t, int32_t)> sub = [](int32_t x, int32_t y) { return x - y; };
+            lua.export_function(sub, "sub");
+
+            WHEN ("they are called in Lua")
+            {
+                lua.run_string("doubled = twice(21) "
+                               "key = tenant_key('config') "
+                               "next_id() next_id() "
+                               "id = next_id() "
+                               "diff = sub(10, 3)");
+
+                THEN ("they are called with their own state.")
+                {
+                    auto s = lua.get_stack();
+                    s->get_global("doubled");
+                    s->get_global("key");
+                    s->get_global("id");
+                    s->get_global("diff");
+                    REQUIRE (s->get<int32_t>(-4) == 42);
+                    REQUIRE (s->get<std::string>(-3) == "tenant-a/config");
+                    REQUIRE (s->get<int32_t>(-2) == 3);
+                    REQUIRE (s->get<int32_t>(-1) == 7);
+                    s->pop(4);
+                    REQUIRE (tenant.use_count() == 2);
+                }
+            }
+        }
+
+        WHEN ("the Lua instance is closed")
+        {
+            THEN ("the captured state is destroyed.")
+            {
+                REQUIRE (tenant.use_count() == 1);
+            }
+        }
+    }
+}
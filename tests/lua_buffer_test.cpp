@@ -0,0 +1,142 @@
+#include <catch.hpp>
+#include <numeric>
+#include <LuaState.h>
+
+
+using lpp::LuaBuffer;
+using lpp::LuaState;
+
+
+LuaBuffer<int32_t> make_range(int32_t n);
+double average(LuaBuffer<double> values);
+#ifdef __cpp_lib_span
+std::span<double> tail(std::span<double> values);
+#endif
+
+
+LuaBuffer<int32_t> make_range(int32_t n)
+{
+    std::vector<int32_t> values(static_cast<size_t>(n));
+    std::iota(values.begin(), values.end(), 1);
+    return LuaBuffer<int32_t>(std::move(values));
+}
+
+double average(LuaBuffer<double> values)
+{
+    if (values.size() == 0) { return 0.0; }
+    return std::accumulate(values.begin(), values.end(), 0.0)
+         / static_cast<double>(values.size());
+}
+
+#ifdef __cpp_lib_span
+std::span<double> tail(std::span<double> values)
+{
+    return values.empty() ? values : values.subspan(1);
+}
+#endif
+
+
+SCENARIO ("Sharing numeric buffers between C++ and Lua")
+{
+    GIVEN ("Lua functions operating on buffers")
+    {
+        LuaState lua;
+        lua.export_function(make_range, "make_range");
+        lua.export_function(average, "average");
+        auto sum = lua.import_function_from("tests/lua_buffer_test.lua")
+                      .with_name("sum")
+                      .with_return_type<double>()
+                      .with_params<LuaBuffer<double>>()
+                      .build();
+        auto scale = lua.import_function_from("tests/lua_buffer_test.lua")
+                        .with_name("scale")
+                        .with_return_type<LuaBuffer<float>>()
+                        .with_params<LuaBuffer<float>, float>()
+                        .build();
+        auto sum_range = lua.import_function_from("tests/lua_buffer_test.lua")
+                            .with_name("sum_range")
+                            .with_return_type<int32_t>()
+                            .with_params<int32_t>()
+                            .build();
+
+        WHEN ("a borrowed buffer is passed to Lua")
+        {
+            std::vector<double> values = { 1.5, 2.5, 3.0 };
+            auto total = sum(LuaBuffer<double>(values.data(), values.size()));
+
+            std::vector<float> floats = { 1.0f, 2.0f };
+            auto scaled = scale(LuaBuffer<float>(floats.data(), floats.size()), 2.0f);
+
+            THEN ("Lua operates directly on the C++ memory.")
+            {
+                REQUIRE (total == 7.0);
+                REQUIRE (floats == std::vector<float>({ 2.0f, 4.0f }));
+                REQUIRE (scaled.data() == floats.data());
+                REQUIRE (!scaled.is_owned());
+            }
+        }
+
+        AND_WHEN ("an exported function returns an owned buffer")
+        {
+            auto total = sum_range(100);
+
+            THEN ("Lua can use it like any other buffer.")
+            {
+                REQUIRE (total == 5050);
+            }
+        }
+
+        AND_WHEN ("a buffer is passed to an exported function")
+        {
+            std::vector<double> values = { 1.0, 2.0, 6.0 };
+            auto s = lua.get_stack();
+            s->push(LuaBuffer<double>(values.data(), values.size()));
+            s->set_global("values");
+            lua.run_string("avg = average(values)");
+
+            THEN ("C++ receives a view on the same memory.")
+            {
+                s->get_global("avg");
+                REQUIRE (s->get<double>(-1) == 3.0);
+            }
+        }
+
+        AND_WHEN ("a script calls the metamethods of a buffer itself")
+        {
+            auto misuse = lua.import_function_from("tests/lua_buffer_test.lua")
+                             .with_name("misuse_metatable")
+                             .with_return_type<bool>()
+                             .with_params<LuaBuffer<int32_t>>()
+                             .build();
+            std::vector<int32_t> values = { 1, 2, 3 };
+
+            THEN ("the metatable is hidden and invalid calls are rejected.")
+            {
+                REQUIRE (misuse(LuaBuffer<int32_t>(values.data(), values.size())));
+            }
+        }
+
+#ifdef __cpp_lib_span
+        AND_WHEN ("spans are passed between C++ and Lua")
+        {
+            lua.export_function(tail, "tail");
+            auto sum_tail = lua.import_function_from("tests/lua_buffer_test.lua")
+                               .with_name("sum_tail")
+                               .with_return_type<double>()
+                               .with_params<std::span<double>>()
+                               .build();
+            std::vector<double> values = { 1.0, 2.0, 6.0 };
+            auto total = sum_tail(values);
+            LuaBuffer<double> buffer = std::span<double>(values);
+
+            THEN ("they are borrowed buffers of the same memory.")
+            {
+                REQUIRE (total == 8.0);
+                REQUIRE (buffer.data() == values.data());
+                REQUIRE (buffer.span().size() == 3);
+                REQUIRE (!buffer.is_owned());
+            }
+        }
+#endif
+    }
+}
@@ -0,0 +1,32 @@
+function sum(buffer)
+    local total = 0
+    for i = 1, #buffer do
+        total = total + buffer[i]
+    end
+    return total
+end
+
+function scale(buffer, factor)
+    for i = 1, #buffer do
+        buffer[i] = buffer[i] * factor
+    end
+    return buffer
+end
+
+function sum_range(n)
+    return sum(make_range(n))
+end
+
+function sum_tail(buffer)
+    return sum(tail(buffer))
+end
+
+function misuse_metatable(buffer)
+    local hidden = getmetatable(buffer) == false
+    local mt = debug.getmetatable(buffer)
+    local bad_len = not pcall(mt.__len, {})
+    mt.__gc(buffer)
+    mt.__gc(buffer)
+    local detached = not pcall(function() return #buffer end)
+    return hidden and bad_len and detached
+end
@@ -0,0 +1,218 @@
+#include <catch.hpp>
+#include <stdexcept>
+#include <LuaState.h>
+#include <LuaFunction.hpp>
+
+
+using lpp::LuaState;
+
+
+struct Range
+{
+    int32_t low = 0;
+    int32_t high = 0;
+
+    Range() = default;
+    Range(const Range& other) = default;
+    Range& operator=(const Range& other)
+    {
+        if (other.low > other.high) { throw std::invalid_argument("empty range"); }
+        low = other.low;
+        high = other.high;
+        return *this;
+    }
+};
+
+namespace lpp
+{
+    template <>
+    struct LuaStruct<Range>
+    {
+        static constexpr auto fields = std::make_tuple(
+            lua_field("low", &Range::low),
+            lua_field("high", &Range::high));
+    };
+}
+
+
+class Counter
+{
+public:
+    static int destroyed;
+
+    int32_t count;
+    int32_t step;
+    std::string name;
+    Range range;
+
+    Counter(std::string counter_name, int32_t start)
+        : count(start)
+        , step(1)
+        , name(std::move(counter_name)) {}
+    ~Counter() { ++destroyed; }
+
+    int32_t increment(int32_t amount)
+    {
+        if (amount < 0) { throw std::invalid_argument("negative increment"); }
+        count += amount;
+        return count;
+    }
+
+    std::string describe() const
+    {
+        return name + ": " + std::to_string(count);
+    }
+};
+
+int Counter::destroyed = 0;
+
+int32_t reset(Counter* counter);
+
+
+int32_t reset(Counter* counter)
+{
+    if (!counter) { return -1; }
+    auto old = counter->count;
+    counter->count = 0;
+    return old;
+}
+
+
+SCENARIO ("Binding C++ classes to Lua")
+{
+    GIVEN ("A C++ class registered in Lua")
+    {
+        LuaState lua;
+        lua.register_class<Counter>("Counter")
+           .constructor<std::string, int32_t>()
+           .method("increment", &Counter::increment)
+           .method("describe", &Counter::describe)
+           .property("count", &Counter::count)
+           .property("step", &Counter::step)
+           .property("range", &Counter::range)
+           .readonly_property("name", &Counter::name);
+        lua.export_function(reset, "reset");
+        lua.run_file("tests/lua_class_test.lua");
+        auto s = lua.get_stack();
+
+        WHEN ("Lua creates objects and calls their methods")
+        {
+            lua.run_string("c = Counter.new('c', 1) "
+                           "n = c:increment(2) "
+                           "d = c:describe() "
+                           "c.count = 40 "
+                           "old = reset(c) "
+                           "none = reset(42)");
+
+            THEN ("they operate on the C++ object.")
+            {
+                s->get_global("n");
+                s->get_global("d");
+                s->get_global("old");
+                s->get_global("none");
+                REQUIRE (s->get<int32_t>(-4) == 3);
+                REQUIRE (s->get<std::string>(-3) == "c: 3");
+                REQUIRE (s->get<int32_t>(-2) == 40);
+                REQUIRE (s->get<int32_t>(-1) == -1);
+                s->pop(4);
+
+                s->get_global("c");
+                auto pcounter = s->get<Counter*>(-1);
+                REQUIRE (pcounter != nullptr);
+                REQUIRE (pcounter->count == 0);
+                REQUIRE (s->get<Counter*>(-2) == nullptr);
+                s->pop(1);
+            }
+        }
+
+        AND_WHEN ("C++ pushes an object to a Lua function")
+        {
+            auto count_to = lua.import_function_from("tests/lua_class_test.lua")
+                               .with_name("count_to")
+                               .with_return_type<int32_t>()
+                               .with_params<Counter*, int32_t>()
+                               .build();
+            auto pcounter = s->push_object<Counter>("pushed", 0);
+            s->set_global("pushed");
+            auto result = count_to(pcounter, 100);
+
+            THEN ("Lua uses the same object.")
+            {
+                REQUIRE (result == 100);
+                REQUIRE (pcounter->count == 100);
+            }
+        }
+
+        AND_WHEN ("properties are assigned in Lua")
+        {
+            auto make_counter = lua.import_function_from("tests/lua_class_test.lua")
+                                   .with_name("make_counter")
+                                   .with_return_type<Counter*>()
+                                   .with_params<std::string>()
+                                   .build();
+            auto pcounter = make_counter("made");
+
+            THEN ("the C++ members are updated.")
+            {
+                REQUIRE (pcounter != nullptr);
+                REQUIRE (pcounter->step == 5);
+                REQUIRE (pcounter->count == 15);
+                REQUIRE (pcounter->name == "made");
+            }
+        }
+
+        AND_WHEN ("Lua misuses an object")
+        {
+            THEN ("errors are raised in Lua.")
+            {
+                REQUIRE_THROWS_AS (lua.run_string("Counter.new('x', 0):increment(-1)"),
+                                   lpp::LuaError);
+                REQUIRE_THROWS_AS (lua.run_string("Counter.new('x', 0).name = 'y'"),
+                                   lpp::LuaError);
+                REQUIRE_THROWS_AS (lua.run_string("Counter.new('x', 0).unknown = 1"),
+                                   lpp::LuaError);
+                REQUIRE_THROWS_AS (lua.run_string("Counter.new('x', 0).increment({}, 1)"),
+                                   lpp::LuaError);
+                try
+                {
+                    lua.run_string("Counter.new('x', 0).range = { low = 2, high = 1 }");
+                    REQUIRE ((false && "unreachable code!"));
+                }
+                catch (lpp::LuaError& e)
+                {
+                    REQUIRE (std::string(e.what()).find("empty range") != std::string::npos);
+                }
+            }
+        }
+
+        AND_WHEN ("a script calls the metamethods of an object itself")
+        {
+            Counter::destroyed = 0;
+            auto misuse = lua.import_function_from("tests/lua_class_test.lua")
+                             .with_name("misuse_metatable")
+                             .with_return_type<bool>()
+                             .with_params<>()
+                             .build();
+            auto rejected = misuse();
+            lua.run_string("collectgarbage()");
+
+            THEN ("the metatable is hidden and the object is destroyed once.")
+            {
+                REQUIRE (rejected);
+                REQUIRE (Counter::destroyed == 1);
+            }
+        }
+
+        AND_WHEN ("objects are no longer reachable")
+        {
+            Counter::destroyed = 0;
+            lua.run_string("for i = 1, 10 do Counter.new('tmp', i) end "
+                           "collectgarbage()");
+
+            THEN ("the garbage collector destroys them.")
+            {
+                REQUIRE (Counter::destroyed == 10);
+            }
+        }
+    }
+}
@@ -0,0 +1,25 @@
+function count_to(counter, n)
+    for i = 1, n do
+        counter:increment(1)
+    end
+    return counter.count
+end
+
+function make_counter(name)
+    made = Counter.new(name, 10)  -- Keeps the object alive
+    made.step = 5
+    made:increment(made.step)
+    return made
+end
+
+function misuse_metatable()
+    local counter = Counter.new('misused', 0)
+    local describe = counter.describe
+    local hidden = getmetatable(counter) == false
+    local mt = debug.getmetatable(counter)
+    mt.__gc(1)
+    mt.__gc(counter)
+    mt.__gc(counter)
+    local detached = not pcall(describe, counter)
+    return hidden and detached
+end
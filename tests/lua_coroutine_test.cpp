@@ -0,0 +1,142 @@
+#include <catch.hpp>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <LuaState.h>
+#include <LuaCoroutine.hpp>
+#include <LuaScheduler.h>
+#include "coroutine_task.hpp"
+
+
+using lpp::LuaState;
+using lpp::LuaError;
+
+
+#ifdef LPP_HAS_COROUTINES
+Task sum_yielded(lpp::LuaScheduler& scheduler,
+                 lpp::LuaCoroutine<int32_t, int32_t>& coroutine,
+                 int32_t& sum);
+
+
+Task sum_yielded(lpp::LuaScheduler& scheduler,
+                 lpp::LuaCoroutine<int32_t, int32_t>& coroutine,
+                 int32_t& sum)
+{
+    sum = 0;
+    sum += co_await scheduler.resume(coroutine, 4);
+    while (!coroutine.is_finished())
+    {
+        sum += co_await scheduler.resume(coroutine, 0);
+    }
+}
+#endif
+
+
+SCENARIO ("Running Lua functions as coroutines")
+{
+    GIVEN ("A Lua state with functions that yield")
+    {
+        LuaState lua;
+        lua.run_file("tests/lua_coroutine_test.lua");
+
+        WHEN ("a coroutine is resumed until it finishes")
+        {
+            auto counter = lua.make_coroutine<int32_t, int32_t>("count_to");
+            std::vector<int32_t> values;
+            values.push_back(counter.resume(3));
+            while (!counter.is_finished())
+            {
+                values.push_back(counter.resume(0));
+            }
+
+            THEN ("the yielded values and the return value are returned in order")
+            {
+                REQUIRE (values == (std::vector<int32_t>{ 1, 2, 3 }));
+            }
+            THEN ("it can not be resumed anymore")
+            {
+                REQUIRE_THROWS_AS(counter.resume(0), LuaError);
+            }
+        }
+
+        WHEN ("values are passed back into a coroutine")
+        {
+            auto accumulate = lua.import_function_from("tests/lua_coroutine_test.lua")
+                                 .with_name("accumulate")
+                                 .with_return_type<int32_t>()
+                                 .with_params<int32_t>()
+                                 .build()
+                                 .make_coroutine();
+            auto first = accumulate.resume(1);
+            auto second = accumulate.resume(2);
+            auto third = accumulate.resume(3);
+
+            THEN ("they are the results of coroutine.yield")
+            {
+                REQUIRE (first == 1);
+                REQUIRE (second == 3);
+                REQUIRE (third == 6);
+                REQUIRE (!accumulate.is_finished());
+            }
+        }
+
+        WHEN ("a coroutine yields multiple values")
+        {
+            auto split = lua.make_coroutine<std::tuple<std::string, int32_t>,
+                                            std::string>("split_name");
+            auto first = split.resume("Ada Lovelace");
+            auto last = split.resume("");
+
+            THEN ("they are converted to a tuple")
+            {
+                REQUIRE (first == std::make_tuple(std::string("Ada"), 3));
+                REQUIRE (last == std::make_tuple(std::string("Lovelace"), 8));
+                REQUIRE (split.is_finished());
+            }
+        }
+
+        WHEN ("a coroutine raises an error")
+        {
+            auto failing = lua.make_coroutine<int32_t>("fail_after_yield");
+            auto first = failing.resume();
+
+            THEN ("it is raised in C++ when resumed and the coroutine finishes")
+            {
+                REQUIRE (first == 1);
+                try
+                {
+                    failing.resume();
+                    REQUIRE ((false && "unreachable code!"));
+                }
+                catch (lpp::LuaError& e)
+                {
+                    REQUIRE (std::string(e.what()) == "coroutine failed");
+                }
+                REQUIRE (failing.is_finished());
+            }
+            THEN ("the main stack can still be used")
+            {
+                REQUIRE_THROWS (failing.resume());
+                auto counter = lua.make_coroutine<int32_t, int32_t>("count_to");
+                REQUIRE (counter.resume(1) == 1);
+            }
+        }
+
+#ifdef LPP_HAS_COROUTINES
+        WHEN ("a coroutine is awaited in a C++ coroutine")
+        {
+            lpp::LuaScheduler scheduler;
+            auto counter = lua.make_coroutine<int32_t, int32_t>("count_to");
+            int32_t sum = -1;
+            sum_yielded(scheduler, counter, sum);
+
+            THEN ("every await resumes it once, without suspending")
+            {
+                REQUIRE (sum == 1 + 2 + 3 + 4);
+                REQUIRE (counter.is_finished());
+                REQUIRE (scheduler.size() == 0);
+            }
+        }
+#endif
+    }
+}
@@ -0,0 +1,27 @@
+
+function count_to(n)
+    for i = 1, n - 1 do
+        coroutine.yield(i)
+    end
+    return n
+end
+
+function accumulate(x)
+    local total = 0
+    while x do
+        total = total + x
+        x = coroutine.yield(total)
+    end
+    return total
+end
+
+function split_name(full_name)
+    local first, last = full_name:match("(%a+) (%a+)")
+    coroutine.yield(first, #first)
+    return last, #last
+end
+
+function fail_after_yield()
+    coroutine.yield(1)
+    error("coroutine failed", 0)
+end
@@ -0,0 +1,83 @@
+#include <catch.hpp>
+#include <LuaExecutor.h>
+
+
+using lpp::LuaExecutor;
+using lpp::LuaExecutorOptions;
+
+
+SCENARIO ("Running Lua functions on multiple threads")
+{
+    GIVEN ("An executor with multiple workers")
+    {
+        LuaExecutorOptions options;
+        options.num_workers = 4;
+        options.scripts = { "tests/lua_executor_test.lua" };
+        LuaExecutor executor(options);
+
+        WHEN ("many calls are submitted")
+        {
+            std::vector<std::future<uint32_t>> results;
+            for (uint32_t i = 0; i < 100; ++i)
+            {
+                results.push_back(executor.submit<uint32_t>("fib", i % 20));
+            }
+            auto greeting = executor.submit<std::string>("greet", std::string("lua"));
+
+            THEN ("all calls return their result.")
+            {
+                const uint32_t fibs[] = { 0, 1, 1, 2, 3, 5, 8, 13, 21, 34, 55, 89,
+                                          144, 233, 377, 610, 987, 1597, 2584, 4181 };
+                for (uint32_t i = 0; i < 100; ++i)
+                {
+                    REQUIRE (results[i].get() == fibs[i % 20]);
+                }
+                REQUIRE (greeting.get() == "hello lua");
+                REQUIRE (executor.num_workers() == 4);
+            }
+        }
+
+        AND_WHEN ("a call raises an error")
+        {
+            auto result = executor.submit<void>("fail");
+
+            THEN ("the error is forwarded through the future.")
+            {
+                try
+                {
+                    result.get();
+                    REQUIRE ((false && "unreachable code!"));
+                }
+                catch (lpp::LuaError& e)
+                {
+                    auto err_msg = std::string(e.what());
+                    REQUIRE (err_msg.find("failure in worker") != std::string::npos);
+                }
+            }
+        }
+    }
+}
+
+SCENARIO ("Calling a Lua function that is defined later on")
+{
+    GIVEN ("An executor with a single worker")
+    {
+        LuaExecutorOptions options;
+        options.num_workers = 1;
+        options.scripts = { "tests/lua_executor_test.lua" };
+        LuaExecutor executor(options);
+
+        WHEN ("the function is called before and after it is defined")
+        {
+            auto before = executor.submit<uint32_t>("late");
+            executor.submit<void>("define_late").get();
+            auto after = executor.submit<uint32_t>("late");
+
+            THEN ("only the first call fails.")
+            {
+                REQUIRE_THROWS_AS (before.get(), lpp::LuaError&);
+                REQUIRE (after.get() == 42);
+            }
+        }
+    }
+}
@@ -0,0 +1,21 @@
+calls = 0
+
+function fib(n)
+    calls = calls + 1
+    if n < 2 then return n end
+    local a, b = 0, 1
+    for _ = 2, n do a, b = b, a + b end
+    return b
+end
+
+function greet(name)
+    return "hello " .. name
+end
+
+function fail()
+    error("failure in worker")
+end
+
+function define_late()
+    function late() return 42 end
+end
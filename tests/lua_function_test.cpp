@@ -7,6 +7,38 @@ using lpp::LuaState;
 using lpp::LuaFunction;
 
 
+struct Rect
+{
+    double width;
+    double height;
+};
+
+struct Shape
+{
+    std::string name;
+    Rect bounds;
+};
+
+namespace lpp
+{
+    template <>
+    struct LuaStruct<Rect>
+    {
+        static constexpr auto fields = std::make_tuple(
+            lua_field("width", &Rect::width),
+            lua_field("height", &Rect::height));
+    };
+
+    template <>
+    struct LuaStruct<Shape>
+    {
+        static constexpr auto fields = std::make_tuple(
+            lua_field("name", &Shape::name),
+            lua_field("bounds", &Shape::bounds));
+    };
+}
+
+
 SCENARIO ("Importing Lua functions into C++")
 {
     GIVEN ("An imported Lua function")
@@ -38,6 +70,262 @@ SCENARIO ("Importing Lua functions into C++")
         }
     }
 
+    GIVEN ("Imported Lua functions with zero or multiple return values")
+    {
+        LuaState lua;
+        auto multi = lua.import_function_from("tests/lua_function_test.lua")
+                        .with_name("multiple_results")
+                        .with_return_type<std::tuple<int32_t, std::string, bool>>()
+                        .with_params<int32_t>()
+                        .build();
+        auto pair = lua.import_function_from("tests/lua_function_test.lua")
+                       .with_name("multiple_results")
+                       .with_return_type<std::pair<int32_t, std::string>>()
+                       .with_params<int32_t>()
+                       .build();
+        auto set_flag = lua.import_function_from("tests/lua_function_test.lua")
+                           .with_name("set_flag")
+                           .with_return_type<void>()
+                           .with_params<>()
+                           .build();
+
+        WHEN ("the imported functions are called")
+        {
+            auto results = multi(21);
+            auto pair_results = pair(-1);
+            set_flag();
+            auto s = lua.get_stack();
+            s->get_global("flag");
+            auto flag = s->get<bool>(-1);
+            s->pop(1);
+
+            THEN ("all results are returned.")
+            {
+                REQUIRE (results == std::make_tuple(42, std::string("value 21"), true));
+                REQUIRE (pair_results == std::make_pair(-2, std::string("value -1")));
+                REQUIRE (flag);
+            }
+        }
+    }
+
+    GIVEN ("An imported Lua function working on tables")
+    {
+        LuaState lua;
+        auto index_words = lua.import_function_from("tests/lua_function_test.lua")
+                              .with_name("index_words")
+                              .with_return_type<std::unordered_map<std::string, int32_t>>()
+                              .with_params<std::vector<std::string>>()
+                              .build();
+
+        WHEN ("the imported function is called with a vector")
+        {
+            auto index = index_words({ "x", "y", "z" });
+
+            THEN ("the resulting table is returned as a map.")
+            {
+                REQUIRE (index.size() == 3);
+                REQUIRE (index["x"] == 1);
+                REQUIRE (index["y"] == 2);
+                REQUIRE (index["z"] == 3);
+            }
+        }
+    }
+
+    GIVEN ("An imported Lua function working on (nested) structs")
+    {
+        LuaState lua;
+        auto grow = lua.import_function_from("tests/lua_function_test.lua")
+                       .with_name("grow")
+                       .with_return_type<Shape>()
+                       .with_params<Shape, double>()
+                       .build();
+
+        WHEN ("the imported function is called with a struct")
+        {
+            auto shape = grow(Shape{ "box", Rect{ 2.0, 3.0 } }, 2.0);
+
+            THEN ("the fields are passed as a table and the result is read back.")
+            {
+                REQUIRE (shape.name == "box (grown)");
+                REQUIRE (shape.bounds.width == 4.0);
+                REQUIRE (shape.bounds.height == 6.0);
+            }
+        }
+    }
+
+    GIVEN ("An imported Lua function that is redefined by a script")
+    {
+        LuaState lua;
+        auto add = lua.import_function_from("tests/lua_function_test.lua")
+                      .with_name("add")
+                      .with_return_type<int32_t>()
+                      .with_params<int32_t, int32_t>()
+                      .build();
+        lua.run_string("function add(x, y) return x * y end");
+
+        WHEN ("the imported function is called before and after rebinding")
+        {
+            auto before = add(3, 4);
+            add.rebind();
+            auto after = add(3, 4);
+
+            THEN ("the cached function is only replaced after rebinding.")
+            {
+                REQUIRE (before == 7);
+                REQUIRE (after == 12);
+            }
+        }
+    }
+
+    GIVEN ("Multiple functions imported from the same file")
+    {
+        LuaState lua;
+        auto first = lua.import_function_from("tests/chunk_cache_test.lua")
+                        .with_name("first")
+                        .with_return_type<int32_t>()
+                        .with_params<>()
+                        .build();
+        auto second = lua.import_function_from("tests/chunk_cache_test.lua")
+                         .with_name("second")
+                         .with_return_type<int32_t>()
+                         .with_params<>()
+                         .build();
+
+        WHEN ("the imported functions are called")
+        {
+            auto x1 = first();
+            auto x2 = second();
+            auto s = lua.get_stack();
+            s->get_global("times_loaded");
+            auto times_loaded = s->get<int32_t>(-1);
+            s->pop(1);
+
+            THEN ("the file was only ran once.")
+            {
+                REQUIRE (x1 == 1);
+                REQUIRE (x2 == 2);
+                REQUIRE (times_loaded == 1);
+            }
+        }
+    }
+
+    GIVEN ("An imported Lua function called on a batch of arguments")
+    {
+        LuaState lua;
+        auto div = lua.import_function_from("tests/lua_function_test.lua")
+                      .with_name("checked_div")
+                      .with_return_type<int32_t>()
+                      .with_params<int32_t, int32_t>()
+                      .build();
+        std::vector<std::tuple<int32_t, int32_t>> args = { { 10, 2 }, { 9, 0 }, { 8, 4 } };
+        std::vector<int32_t> results(args.size(), -1);
+
+        WHEN ("errors are recorded")
+        {
+            auto errors = div.call_batch(args.begin(), args.end(), results.begin(),
+                                         lpp::LuaBatchMode::record_errors);
+
+            THEN ("every call is done and the failed ones are reported.")
+            {
+                REQUIRE (results == std::vector<int32_t>({ 5, 0, 2 }));
+                REQUIRE (errors.size() == 1);
+                REQUIRE (errors[0].index == 1);
+                REQUIRE (errors[0].message == "division by zero");
+            }
+        }
+
+        AND_WHEN ("the batch stops on the first error")
+        {
+            THEN ("the error is raised and the remaining calls are skipped.")
+            {
+                try
+                {
+                    div.call_batch(args.begin(), args.end(), results.begin());
+                    REQUIRE ((false && "unreachable code!"));
+                }
+                catch (lpp::LuaError& e)
+                {
+                    REQUIRE (std::string(e.what()) == "division by zero");
+                    REQUIRE (results == std::vector<int32_t>({ 5, -1, -1 }));
+                }
+                REQUIRE (div(6, 3) == 2);
+            }
+        }
+
+#ifdef __cpp_lib_span
+        AND_WHEN ("the batch is passed as spans")
+        {
+            auto errors = div.call_batch(args, results, lpp::LuaBatchMode::record_errors);
+
+            THEN ("the results are stored at the position of their arguments.")
+            {
+                REQUIRE (results == std::vector<int32_t>({ 5, 0, 2 }));
+                REQUIRE (errors.size() == 1);
+                REQUIRE (errors[0].index == 1);
+            }
+        }
+#endif
+    }
+
+    GIVEN ("A Lua function that raises an error in a nested call")
+    {
+        LuaState lua;
+        auto fail = lua.import_function_from("tests/lua_function_test.lua")
+                       .with_name("fail_outer")
+                       .with_return_type<int32_t>()
+                       .with_params<int32_t>()
+                       .build();
+        auto count_tracebacks = [&fail](int32_t calls) {
+            int32_t tracebacks = 0;
+            for (int32_t i = 0; i < calls; ++i)
+            {
+                try
+                {
+                    fail(i);
+                }
+                catch (lpp::LuaError& e)
+                {
+                    REQUIRE (std::string(e.what()) == "failed with " + std::to_string(i));
+                    REQUIRE (e.status() == LUA_ERRRUN);
+                    if (!e.traceback().empty())
+                    {
+                        REQUIRE (e.traceback().find("fail_inner") != std::string::npos);
+                        ++tracebacks;
+                    }
+                }
+            }
+            return tracebacks;
+        };
+
+        WHEN ("no tracebacks are requested")
+        {
+            THEN ("only the message and status are reported.")
+            {
+                REQUIRE (count_tracebacks(3) == 0);
+            }
+        }
+
+        AND_WHEN ("tracebacks are always captured")
+        {
+            lua.set_traceback_mode(lpp::LuaTraceback::always);
+
+            THEN ("every error has a traceback.")
+            {
+                REQUIRE (count_tracebacks(3) == 3);
+            }
+        }
+
+        AND_WHEN ("tracebacks are sampled")
+        {
+            lua.set_traceback_mode(lpp::LuaTraceback::sampled, 3);
+
+            THEN ("only the sampled errors have a traceback.")
+            {
+                REQUIRE (count_tracebacks(6) == 2);
+            }
+        }
+    }
+
     GIVEN ("A Lua function that raises an error")
     {
         LuaState lua;
@@ -5,3 +5,38 @@ end
 function multiply_string(str, amount)
     return string.rep(str, amount)
 end
+
+function checked_div(x, y)
+    if y == 0 then error("division by zero", 0) end
+    return x // y
+end
+
+function multiple_results(x)
+    return x * 2, "value " .. x, x > 0
+end
+
+function index_words(words)
+    local index = {}
+    for i, word in ipairs(words) do index[word] = i end
+    return index
+end
+
+function grow(shape, factor)
+    return {
+        name = shape.name .. " (grown)",
+        bounds = { width = shape.bounds.width * factor, height = shape.bounds.height * factor }
+    }
+end
+
+function fail_inner(x)
+    error("failed with " .. x, 0)
+end
+
+function fail_outer(x)
+    fail_inner(x)
+    return x
+end
+
+function set_flag()
+    flag = true
+end
@@ -0,0 +1,121 @@
+#include <catch.hpp>
+#include <stdexcept>
+#include <LuaStatePool.h>
+
+
+using lpp::LuaState;
+using lpp::LuaStatePool;
+using lpp::LuaStatePoolOptions;
+
+
+static uint32_t get_global_uint(LuaState& lua, const std::string& name)
+{
+    auto s = lua.get_stack();
+    s->get_global(name);
+    auto value = s->get<uint32_t>(-1);
+    s->pop(1);
+    return value;
+}
+
+
+SCENARIO ("Using a pool of LuaStates")
+{
+    GIVEN ("A pool of pre-warmed LuaStates")
+    {
+        uint32_t times_initialized = 0;
+        bool init_fails = false;
+        LuaStatePoolOptions options;
+        options.size = 2;
+        options.init = [&](LuaState& lua) {
+            if (init_fails) { throw std::runtime_error("init failed"); }
+            ++times_initialized;
+            lua.run_string("counter = 0");
+        };
+        options.reset = [](LuaState& lua) {
+            lua.run_string("assert(counter < 10) counter = 0");
+        };
+        options.gc_step_kb = 16;
+        LuaStatePool pool(options);
+
+        WHEN ("a state is checked out")
+        {
+            auto lua = pool.checkout();
+            lua->run_string("counter = counter + 1");
+
+            THEN ("it was initialized once and can be used.")
+            {
+                REQUIRE (lua);
+                REQUIRE (times_initialized == 2);
+                REQUIRE (get_global_uint(*lua, "counter") == 1);
+                REQUIRE (pool.metrics().in_use == 1);
+            }
+        }
+
+        AND_WHEN ("a state is returned to the pool")
+        {
+            {
+                auto lua = pool.checkout();
+                lua->run_string("counter = counter + 1");
+            }
+            auto lua1 = pool.checkout();
+            auto lua2 = pool.checkout();
+
+            THEN ("it was reset before being handed out again.")
+            {
+                REQUIRE (get_global_uint(*lua1, "counter") == 0);
+                REQUIRE (get_global_uint(*lua2, "counter") == 0);
+                REQUIRE (times_initialized == 2);
+            }
+        }
+
+        AND_WHEN ("all states are in use")
+        {
+            auto lua1 = pool.checkout();
+            auto lua2 = pool.checkout();
+            auto lua3 = pool.try_checkout(std::chrono::milliseconds(10));
+            auto metrics = pool.metrics();
+
+            THEN ("a bounded checkout times out.")
+            {
+                REQUIRE (!lua3);
+                REQUIRE (metrics.size == 2);
+                REQUIRE (metrics.in_use == 2);
+                REQUIRE (metrics.peak_in_use == 2);
+                REQUIRE (metrics.checkouts == 2);
+                REQUIRE (metrics.timeouts == 1);
+            }
+        }
+
+        AND_WHEN ("resetting a state fails")
+        {
+            pool.checkout()->run_string("counter = 100");
+            auto lua1 = pool.checkout();
+            auto lua2 = pool.checkout();
+
+            THEN ("the state is replaced by a new one.")
+            {
+                REQUIRE (times_initialized == 3);
+                REQUIRE (get_global_uint(*lua1, "counter") == 0);
+                REQUIRE (get_global_uint(*lua2, "counter") == 0);
+                REQUIRE (pool.metrics().size == 2);
+            }
+        }
+
+        AND_WHEN ("a failing state can not be replaced right away")
+        {
+            init_fails = true;
+            pool.checkout()->run_string("counter = 100");
+            auto lua1 = pool.checkout();
+
+            THEN ("the next checkout tries again instead of waiting forever.")
+            {
+                REQUIRE_THROWS (pool.checkout());
+                init_fails = false;
+                auto lua2 = pool.checkout();
+                REQUIRE (lua2);
+                REQUIRE (times_initialized == 3);
+                REQUIRE (get_global_uint(*lua2, "counter") == 0);
+            }
+        }
+    }
+}
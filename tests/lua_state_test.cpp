@@ -1,4 +1,5 @@
 #include <catch.hpp>
+#include <limits>
 #include <LuaState.h>
 
 
@@ -79,3 +80,169 @@ SCENARIO ("LuaState usage (incorrect usage)")
         }
     }
 }
+
+SCENARIO ("LuaState integer conversions")
+{
+    GIVEN ("A LuaState with integers and floats")
+    {
+        LuaState lua;
+        lua.run_string("big_int = 9007199254740993 "
+                       "frac = 1.5 neg = -1 large = 1 << 40");
+        auto s = lua.get_stack();
+
+        WHEN ("64-bit integers are read and written")
+        {
+            s->get_global("big_int");
+            auto big_int = s->get<int64_t>(-1);
+            s->push(big_int + 1);
+            auto big_int_next = s->get<int64_t>(-1);
+            s->push(std::numeric_limits<uint64_t>::max());
+            auto max_uint64 = s->get<uint64_t>(-1);
+
+            THEN ("no precision is lost.")
+            {
+                REQUIRE (big_int == 9007199254740993);
+                REQUIRE (big_int_next == 9007199254740994);
+                REQUIRE (max_uint64 == std::numeric_limits<uint64_t>::max());
+            }
+        }
+
+        AND_WHEN ("integers are read with overflow checks")
+        {
+            s->get_global("large");
+            s->get_global("frac");
+            s->get_global("neg");
+
+            THEN ("values that do not fit are reported.")
+            {
+                REQUIRE (s->get_checked<int64_t>(-3) == (int64_t(1) << 40));
+                REQUIRE (s->get_checked<int32_t>(-1) == -1);
+                REQUIRE_THROWS_AS (s->get_checked<int32_t>(-3), lpp::LuaError);
+                REQUIRE_THROWS_AS (s->get_checked<int64_t>(-2), lpp::LuaError);
+                REQUIRE_THROWS_AS (s->get_checked<uint32_t>(-1), lpp::LuaError);
+                REQUIRE_THROWS_AS (s->get_checked<uint64_t>(-1), lpp::LuaError);
+                REQUIRE_THROWS_AS (s->get_checked<size_t>(-1), lpp::LuaError);
+            }
+        }
+    }
+}
+
+SCENARIO ("LuaState memory usage")
+{
+    GIVEN ("A LuaState")
+    {
+        LuaState lua;
+
+        WHEN ("a script allocating memory is ran")
+        {
+            auto before = lua.memory_stats();
+            lua.run_string("t = {} for i = 1, 10000 do t[i] = 'str' .. i end");
+            auto after = lua.memory_stats();
+
+            THEN ("the memory usage is tracked.")
+            {
+                REQUIRE (after.current_bytes > before.current_bytes);
+                REQUIRE (after.peak_bytes >= after.current_bytes);
+                REQUIRE (after.allocation_count > before.allocation_count);
+            }
+        }
+
+        AND_WHEN ("a script exceeds the memory limit")
+        {
+            auto limit = lua.memory_stats().current_bytes + 64 * 1024;
+            lua.set_memory_limit(limit);
+
+            THEN ("a memory error is raised and the state remains usable.")
+            {
+                try
+                {
+                    lua.run_string("t = {} for i = 1, 1e7 do t[i] = 'str' .. i end");
+                    REQUIRE ((false && "unreachable code!"));
+                }
+                catch (lpp::LuaMemoryError& e)
+                {
+                    REQUIRE (std::string(e.what()) == "not enough memory");
+                }
+
+                lua.run_string("t = nil collectgarbage() x = 42");
+                auto s = lua.get_stack();
+                s->get_global("x");
+                REQUIRE (s->get<uint32_t>(-1) == 42);
+                REQUIRE (lua.memory_stats().current_bytes <= limit);
+                REQUIRE (lua.memory_stats().failed_allocations > 0);
+            }
+        }
+    }
+}
+
+SCENARIO ("LuaState standard library selection")
+{
+    GIVEN ("A LuaState with only the base and math libraries")
+    {
+        lpp::LuaStateOptions options;
+        options.libs = lpp::LuaLibs::base | lpp::LuaLibs::math;
+        LuaState lua(options);
+
+        WHEN ("the libraries are used")
+        {
+            lua.run_string("x = math.floor(4.5) has_io = io ~= nil");
+            auto s = lua.get_stack();
+            s->get_global("x");
+            s->get_global("has_io");
+
+            THEN ("only the selected libraries are available.")
+            {
+                REQUIRE (s->get<uint32_t>(-2) == 4);
+                REQUIRE (s->get<bool>(-1) == false);
+            }
+        }
+    }
+
+    GIVEN ("A LuaState with lazily loaded libraries")
+    {
+        lpp::LuaStateOptions options;
+        options.libs = lpp::LuaLibs::all & ~lpp::LuaLibs::os;
+        options.lazy_libs = true;
+        LuaState lua(options);
+
+        WHEN ("the libraries are used")
+        {
+            lua.run_string("before = rawget(_G, 'table') ~= nil "
+                           "x = table.concat({ 'a', 'b' }) "
+                           "after = rawget(_G, 'table') ~= nil "
+                           "has_os = os ~= nil "
+                           "y = ('abc'):upper()");
+            auto s = lua.get_stack();
+            s->get_global("before");
+            s->get_global("x");
+            s->get_global("after");
+            s->get_global("has_os");
+            s->get_global("y");
+
+            THEN ("they are opened on first access.")
+            {
+                REQUIRE (s->get<bool>(-5) == false);
+                REQUIRE (s->get<std::string>(-4) == "ab");
+                REQUIRE (s->get<bool>(-3) == true);
+                REQUIRE (s->get<bool>(-2) == false);
+                REQUIRE (s->get<std::string>(-1) == "ABC");
+            }
+        }
+
+        AND_WHEN ("a library is required before its global was accessed")
+        {
+            lua.run_string("local m = require('math') "
+                           "x = m.max(1, 2) "
+                           "same = m == math");
+            auto s = lua.get_stack();
+            s->get_global("x");
+            s->get_global("same");
+
+            THEN ("it is opened by require.")
+            {
+                REQUIRE (s->get<int32_t>(-2) == 2);
+                REQUIRE (s->get<bool>(-1) == true);
+            }
+        }
+    }
+}